@@ -0,0 +1,163 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * qmicli -- Command line interface to control QMI devices
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include <glib.h>
+
+#include <libqmi-glib.h>
+#include <jansson.h>
+
+#include "qmicli.h"
+
+/* Arena backing every Jansson allocation. Allocating is a pointer bump and
+ * freeing only counts live blocks; once the last block of a response is
+ * gone, the whole arena is rewound at once. Main thread only. */
+
+#define ARENA_CHUNK_SIZE 16384
+#define ARENA_ALIGN      (2 * sizeof (gpointer))
+
+typedef struct _ArenaChunk ArenaChunk;
+struct _ArenaChunk {
+    ArenaChunk *next;
+    gsize size;
+    gsize used;
+    /* Keeps data[] aligned */
+    gpointer padding;
+    guint8 data[];
+};
+
+static ArenaChunk *chunks;
+static guint n_chunks;
+static gulong n_live;
+static gulong n_live_reported;
+
+static ArenaChunk *
+arena_chunk_new (gsize size)
+{
+    ArenaChunk *chunk;
+
+    chunk = g_malloc (sizeof (ArenaChunk) + size);
+    chunk->size = size;
+    chunk->used = 0;
+    chunk->next = chunks;
+    chunks = chunk;
+    n_chunks++;
+    return chunk;
+}
+
+/* If the last response needed more than one chunk, a single chunk big enough
+ * for all of it replaces them, so the arena settles at its high-water mark */
+static void
+arena_rewind (void)
+{
+    ArenaChunk *chunk;
+    gsize total = 0;
+
+    if (n_chunks == 1) {
+        chunks->used = 0;
+        return;
+    }
+
+    while (chunks) {
+        chunk = chunks;
+        chunks = chunk->next;
+        total += chunk->size;
+        g_free (chunk);
+    }
+    n_chunks = 0;
+    arena_chunk_new (total);
+}
+
+static void *
+arena_malloc (size_t size)
+{
+    ArenaChunk *chunk;
+    gpointer block;
+
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+    chunk = chunks;
+    if (chunk->used + size > chunk->size)
+        chunk = arena_chunk_new (MAX (size, ARENA_CHUNK_SIZE));
+
+    block = &chunk->data[chunk->used];
+    chunk->used += size;
+    n_live++;
+    return block;
+}
+
+static void
+arena_free (void *block)
+{
+    if (!block)
+        return;
+
+    g_assert (n_live > 0);
+    if (--n_live == 0)
+        arena_rewind ();
+}
+
+gulong
+qmicli_arena_get_live (void)
+{
+    return n_live;
+}
+
+/* Long-running modes call this once an output line is written, when no value
+ * should be alive anymore; one that is keeps the arena from ever being
+ * rewound, so it grows for as long as the mode runs. Warned about, once per
+ * growth, unless built with G_DISABLE_ASSERT. */
+gboolean
+qmicli_arena_check (const gchar *where)
+{
+#ifndef G_DISABLE_ASSERT
+    if (n_live > n_live_reported) {
+        g_warning ("%lu JSON block(s) still alive after %s: leaked, the arena can't be rewound",
+                   n_live, where);
+        n_live_reported = n_live;
+    }
+#endif
+    return n_live == 0;
+}
+
+void
+qmicli_arena_init (void)
+{
+    arena_chunk_new (ARENA_CHUNK_SIZE);
+    json_set_alloc_funcs (arena_malloc, arena_free);
+}
+
+void
+qmicli_arena_shutdown (void)
+{
+    ArenaChunk *chunk;
+
+    /* Values still referenced at exit go away with the arena */
+    json_set_alloc_funcs (malloc, free);
+    while (chunks) {
+        chunk = chunks;
+        chunks = chunk->next;
+        g_free (chunk);
+    }
+    n_chunks = 0;
+    n_live = 0;
+    n_live_reported = 0;
+}
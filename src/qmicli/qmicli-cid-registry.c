@@ -0,0 +1,180 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * qmicli -- Command line interface to control QMI devices
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <libqmi-glib.h>
+
+#include "qmicli.h"
+#include "qmicli-helpers.h"
+
+/* CIDs kept allocated between invocations, per device and service, in a key
+ * file locked while it's read and rewritten */
+
+#define CID_REGISTRY_GROUP "cids"
+
+gchar *
+qmicli_cid_registry_get_path (const gchar *device_path)
+{
+    return qmicli_get_runtime_file_path (device_path, "cids");
+}
+
+/* Opens and exclusively locks the registry; the lock goes away on close() */
+static gint
+cid_registry_open (const gchar *registry_path,
+                   GKeyFile **out_key_file,
+                   GError **error)
+{
+    GString *contents;
+    gchar buffer[512];
+    gchar *dirname;
+    gssize n_read;
+    gint fd;
+
+    dirname = g_path_get_dirname (registry_path);
+    g_mkdir_with_parents (dirname, 0700);
+    g_free (dirname);
+
+    fd = g_open (registry_path, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+                     "couldn't open CID registry '%s': %s",
+                     registry_path, g_strerror (errno));
+        return -1;
+    }
+
+    if (flock (fd, LOCK_EX) < 0) {
+        g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+                     "couldn't lock CID registry '%s': %s",
+                     registry_path, g_strerror (errno));
+        close (fd);
+        return -1;
+    }
+
+    contents = g_string_new (NULL);
+    while ((n_read = read (fd, buffer, sizeof (buffer))) > 0)
+        g_string_append_len (contents, buffer, n_read);
+
+    *out_key_file = g_key_file_new ();
+    if (contents->len > 0 &&
+        !g_key_file_load_from_data (*out_key_file, contents->str, contents->len,
+                                    G_KEY_FILE_NONE, NULL))
+        g_debug ("Ignoring unreadable CID registry '%s'", registry_path);
+    g_string_free (contents, TRUE);
+
+    return fd;
+}
+
+static gboolean
+cid_registry_close (gint fd,
+                    GKeyFile *key_file,
+                    const gchar *registry_path,
+                    GError **error)
+{
+    gboolean written = TRUE;
+    gchar *data;
+    gsize length;
+
+    data = g_key_file_to_data (key_file, &length, NULL);
+    if (lseek (fd, 0, SEEK_SET) < 0 ||
+        ftruncate (fd, 0) < 0 ||
+        write (fd, data, length) != (gssize)length) {
+        g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+                     "couldn't write CID registry '%s': %s",
+                     registry_path, g_strerror (errno));
+        written = FALSE;
+    }
+
+    g_free (data);
+    g_key_file_free (key_file);
+    close (fd);
+    return written;
+}
+
+gboolean
+qmicli_cid_registry_take (const gchar *registry_path,
+                          const gchar *service,
+                          guint8 *out_cid,
+                          GError **error)
+{
+    GKeyFile *key_file;
+    gint *cids;
+    gsize n_cids = 0;
+    gsize i;
+    gint fd;
+
+    fd = cid_registry_open (registry_path, &key_file, error);
+    if (fd < 0)
+        return FALSE;
+
+    *out_cid = 0;
+    cids = g_key_file_get_integer_list (key_file, CID_REGISTRY_GROUP, service, &n_cids, NULL);
+    for (i = 0; i < n_cids && !*out_cid; i++) {
+        /* Skip anything that can't be a CID */
+        if (cids[i] > 0 && cids[i] <= G_MAXUINT8)
+            *out_cid = (guint8)cids[i];
+    }
+
+    /* Whatever was taken or skipped is gone from the registry */
+    if (i < n_cids)
+        g_key_file_set_integer_list (key_file, CID_REGISTRY_GROUP, service, &cids[i], n_cids - i);
+    else
+        g_key_file_remove_key (key_file, CID_REGISTRY_GROUP, service, NULL);
+    g_free (cids);
+
+    return cid_registry_close (fd, key_file, registry_path, error);
+}
+
+gboolean
+qmicli_cid_registry_put (const gchar *registry_path,
+                         const gchar *service,
+                         guint8 cid,
+                         GError **error)
+{
+    GKeyFile *key_file;
+    gint *cids;
+    gsize n_cids = 0;
+    gsize i;
+    gint fd;
+
+    fd = cid_registry_open (registry_path, &key_file, error);
+    if (fd < 0)
+        return FALSE;
+
+    cids = g_key_file_get_integer_list (key_file, CID_REGISTRY_GROUP, service, &n_cids, NULL);
+    for (i = 0; i < n_cids; i++) {
+        if (cids[i] == cid)
+            break;
+    }
+    if (i == n_cids) {
+        cids = g_renew (gint, cids, n_cids + 1);
+        cids[n_cids++] = cid;
+        g_key_file_set_integer_list (key_file, CID_REGISTRY_GROUP, service, cids, n_cids);
+    }
+    g_free (cids);
+
+    return cid_registry_close (fd, key_file, registry_path, error);
+}
@@ -0,0 +1,376 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * qmicli -- Command line interface to control QMI devices
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "config.h"
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <libqmi-glib.h>
+#include <jansson.h>
+
+#include "qmicli.h"
+
+/* See QmicliCoalescedMessage: libqmi moved its client methods to GTask in
+ * 1.16, and their _finish() functions no longer accept our results there */
+G_STATIC_ASSERT (QMI_CHECK_VERSION (1, 9, 0) && !QMI_CHECK_VERSION (1, 16, 0));
+
+/* Identical read-only requests in flight at the same time share a single
+ * QMI transaction. The first caller issues it; later callers with the same
+ * message and input just wait for it, and once the response arrives every
+ * one of them gets its own result, which its usual _finish() call reads.
+ * A waiter whose cancellable is cancelled completes right away, and the
+ * transaction itself is cancelled once no waiter is left.
+ *
+ * Messages with a freshness window also keep their last successful response
+ * around for that long; reads within the window are answered from it, and
+ * the result then carries the age of the response. Indications telling that
+ * the data changed drop it earlier. */
+
+#define AGE_KEY "qmicli-age-ms"
+
+typedef struct _Flight Flight;
+
+typedef struct {
+    Flight *flight;
+    GObject *source;
+    GCancellable *cancellable;
+    gulong cancelled_id;
+    guint cancelled_idle_id;
+    GAsyncReadyCallback callback;
+    gpointer user_data;
+} Waiter;
+
+struct _Flight {
+    gchar *key;
+    const QmicliCoalescedMessage *message;
+    GSList *waiters;
+    /* Cancels the transaction once every waiter is gone */
+    GCancellable *cancellable;
+    /* Unset if invalidated while in flight */
+    gboolean cacheable;
+};
+
+typedef struct {
+    const QmicliCoalescedMessage *message;
+    gpointer output;
+    gint64 timestamp;
+} CacheEntry;
+
+static GHashTable *flights;
+static GHashTable *cache;
+
+static void
+waiter_free (Waiter *waiter)
+{
+    if (waiter->cancelled_idle_id)
+        g_source_remove (waiter->cancelled_idle_id);
+    if (waiter->cancellable) {
+        g_cancellable_disconnect (waiter->cancellable, waiter->cancelled_id);
+        g_object_unref (waiter->cancellable);
+    }
+    g_object_unref (waiter->source);
+    g_slice_free (Waiter, waiter);
+}
+
+static void
+flight_free (Flight *flight)
+{
+    g_slist_free_full (flight->waiters, (GDestroyNotify)waiter_free);
+    g_object_unref (flight->cancellable);
+    g_free (flight->key);
+    g_slice_free (Flight, flight);
+}
+
+/* Callers arriving from now on start a new transaction */
+static void
+flight_detach (Flight *flight)
+{
+    if (g_hash_table_lookup (flights, flight->key) == flight)
+        g_hash_table_steal (flights, flight->key);
+}
+
+static void
+cache_entry_free (CacheEntry *entry)
+{
+    entry->message->output_unref (entry->output);
+    g_slice_free (CacheEntry, entry);
+}
+
+static void
+cache_store (const gchar *key,
+             const QmicliCoalescedMessage *message,
+             gpointer output)
+{
+    CacheEntry *entry;
+
+    if (!cache)
+        cache = g_hash_table_new_full (g_str_hash,
+                                       g_str_equal,
+                                       g_free,
+                                       (GDestroyNotify)cache_entry_free);
+
+    entry = g_slice_new (CacheEntry);
+    entry->message = message;
+    entry->output = message->output_ref (output);
+    entry->timestamp = g_get_monotonic_time ();
+    g_hash_table_replace (cache, g_strdup (key), entry);
+}
+
+/* Age in ms of a fresh enough cached response, or -1 */
+static gint64
+cache_lookup (const gchar *key,
+              const QmicliCoalescedMessage *message,
+              gpointer *output)
+{
+    CacheEntry *entry;
+    gint64 age;
+
+    if (!cache || !message->ttl_ms)
+        return -1;
+
+    entry = g_hash_table_lookup (cache, key);
+    if (!entry)
+        return -1;
+
+    age = (g_get_monotonic_time () - entry->timestamp) / 1000;
+    if (age >= message->ttl_ms) {
+        g_hash_table_remove (cache, key);
+        return -1;
+    }
+
+    *output = entry->output;
+    return age;
+}
+
+/* Run from an idle, as the handler of the cancellable can't disconnect it */
+static gboolean
+waiter_cancelled_idle (Waiter *waiter)
+{
+    Flight *flight = waiter->flight;
+    GSimpleAsyncResult *result;
+
+    waiter->cancelled_idle_id = 0;
+    flight->waiters = g_slist_remove (flight->waiters, waiter);
+
+    result = g_simple_async_result_new_error (waiter->source,
+                                              waiter->callback,
+                                              waiter->user_data,
+                                              G_IO_ERROR,
+                                              G_IO_ERROR_CANCELLED,
+                                              "Operation was cancelled");
+    g_simple_async_result_complete (result);
+    g_object_unref (result);
+    waiter_free (waiter);
+
+    if (!flight->waiters) {
+        g_debug ("Cancelling '%s', no one is waiting for it", flight->key);
+        flight_detach (flight);
+        g_cancellable_cancel (flight->cancellable);
+    }
+    return FALSE;
+}
+
+static void
+waiter_cancelled (GCancellable *cancellable,
+                  Waiter *waiter)
+{
+    if (!waiter->cancelled_idle_id)
+        waiter->cancelled_idle_id = g_idle_add ((GSourceFunc)waiter_cancelled_idle, waiter);
+}
+
+static void
+flight_ready (GObject *source,
+              GAsyncResult *res,
+              Flight *flight)
+{
+    GError *error = NULL;
+    gpointer output;
+    GSList *l;
+
+    output = flight->message->finish (source, res, &error);
+    if (output &&
+        flight->cacheable &&
+        flight->message->ttl_ms &&
+        flight->message->get_result (output, NULL))
+        cache_store (flight->key, flight->message, output);
+
+    flight_detach (flight);
+
+    /* Waiters were prepended */
+    flight->waiters = g_slist_reverse (flight->waiters);
+    g_debug ("Response to '%s' shared by %u request(s)",
+             flight->key, g_slist_length (flight->waiters));
+
+    for (l = flight->waiters; l; l = g_slist_next (l)) {
+        Waiter *waiter = l->data;
+        GSimpleAsyncResult *result;
+
+        result = g_simple_async_result_new (waiter->source,
+                                            waiter->callback,
+                                            waiter->user_data,
+                                            (gpointer)qmicli_coalesce_call);
+        if (waiter->cancellable)
+            g_simple_async_result_set_check_cancellable (result, waiter->cancellable);
+        if (output)
+            g_simple_async_result_set_op_res_gpointer (result,
+                                                       flight->message->output_ref (output),
+                                                       flight->message->output_unref);
+        else
+            g_simple_async_result_set_from_error (result, error);
+        g_simple_async_result_complete (result);
+        g_object_unref (result);
+    }
+
+    if (output)
+        flight->message->output_unref (output);
+    if (error)
+        g_error_free (error);
+    flight_free (flight);
+}
+
+/* 'input_key' identifies the contents of 'input'; NULL when there is none */
+void
+qmicli_coalesce_call (const QmicliCoalescedMessage *message,
+                      GObject *client,
+                      gpointer input,
+                      const gchar *input_key,
+                      guint timeout,
+                      GCancellable *cancellable,
+                      GAsyncReadyCallback callback,
+                      gpointer user_data)
+{
+    Flight *flight;
+    Waiter *waiter;
+    gpointer output;
+    gchar *key;
+    gint64 age;
+
+    if (!flights)
+        flights = g_hash_table_new (g_str_hash, g_str_equal);
+
+    key = g_strdup_printf ("%s/%s", message->name, input_key ? input_key : "");
+
+    age = cache_lookup (key, message, &output);
+    if (age >= 0) {
+        GSimpleAsyncResult *result;
+
+        g_debug ("Answering '%s' from a response %" G_GINT64_FORMAT " ms old", key, age);
+        result = g_simple_async_result_new (client,
+                                            callback,
+                                            user_data,
+                                            (gpointer)qmicli_coalesce_call);
+        if (cancellable)
+            g_simple_async_result_set_check_cancellable (result, cancellable);
+        g_simple_async_result_set_op_res_gpointer (result,
+                                                   message->output_ref (output),
+                                                   message->output_unref);
+        g_object_set_data (G_OBJECT (result), AGE_KEY, GUINT_TO_POINTER ((guint)age + 1));
+        g_simple_async_result_complete_in_idle (result);
+        g_object_unref (result);
+        g_free (key);
+        return;
+    }
+
+    flight = g_hash_table_lookup (flights, key);
+    if (flight) {
+        g_debug ("Joining in-flight '%s'", key);
+        g_free (key);
+    } else {
+        flight = g_slice_new0 (Flight);
+        flight->key = key;
+        flight->message = message;
+        flight->cancellable = g_cancellable_new ();
+        flight->cacheable = TRUE;
+        g_hash_table_insert (flights, flight->key, flight);
+
+        message->method (client,
+                         input,
+                         timeout,
+                         flight->cancellable,
+                         (GAsyncReadyCallback)flight_ready,
+                         flight);
+    }
+
+    waiter = g_slice_new0 (Waiter);
+    waiter->flight = flight;
+    waiter->source = g_object_ref (client);
+    waiter->callback = callback;
+    waiter->user_data = user_data;
+    flight->waiters = g_slist_prepend (flight->waiters, waiter);
+    if (cancellable) {
+        waiter->cancellable = g_object_ref (cancellable);
+        waiter->cancelled_id = g_cancellable_connect (cancellable,
+                                                      G_CALLBACK (waiter_cancelled),
+                                                      waiter,
+                                                      NULL);
+    }
+}
+
+/* Drops cached responses whose key starts with 'prefix', e.g. when an
+ * indication tells that what they hold is out of date */
+void
+qmicli_coalesce_invalidate (const gchar *prefix)
+{
+    GHashTableIter iter;
+    const gchar *key;
+    Flight *flight;
+
+    /* Responses on their way may predate the change too: their waiters still
+     * get them, but later callers start a new transaction */
+    if (flights) {
+        g_hash_table_iter_init (&iter, flights);
+        while (g_hash_table_iter_next (&iter, (gpointer *)&key, (gpointer *)&flight)) {
+            if (g_str_has_prefix (key, prefix)) {
+                flight->cacheable = FALSE;
+                g_hash_table_iter_steal (&iter);
+            }
+        }
+    }
+
+    if (!cache)
+        return;
+
+    g_hash_table_iter_init (&iter, cache);
+    while (g_hash_table_iter_next (&iter, (gpointer *)&key, NULL)) {
+        if (g_str_has_prefix (key, prefix))
+            g_hash_table_iter_remove (&iter);
+    }
+}
+
+/* Adds "age_ms" to the output of results answered from the cache */
+void
+qmicli_coalesce_json_add_age (json_t *json,
+                              GAsyncResult *res)
+{
+    gpointer age;
+
+    age = g_object_get_data (G_OBJECT (res), AGE_KEY);
+    if (age)
+        json_object_set_new (json, "age_ms", json_integer (GPOINTER_TO_UINT (age) - 1));
+}
+
+void
+qmicli_coalesce_shutdown (void)
+{
+    if (cache) {
+        g_hash_table_destroy (cache);
+        cache = NULL;
+    }
+}
@@ -32,12 +32,14 @@
 
 #include "qmicli.h"
 #include "qmicli-helpers.h"
+#include "qmicli-json-generated.h"
 
 /* Context */
 typedef struct {
     QmiDevice *device;
     QmiClientDms *client;
     GCancellable *cancellable;
+    QmicliRequest *request;
 } Context;
 static Context *ctx;
 
@@ -335,6 +337,7 @@ context_free (Context *context)
 
     if (context->cancellable)
         g_object_unref (context->cancellable);
+    qmicli_request_free (context->request);
     if (context->device)
         g_object_unref (context->device);
     if (context->client)
@@ -354,43 +357,42 @@ static void
 get_ids_ready (QmiClientDms *client,
                GAsyncResult *res)
 {
-    const gchar *esn = NULL;
-    const gchar *imei = NULL;
-    const gchar *meid = NULL;
     QmiMessageDmsGetIdsOutput *output;
     GError *error = NULL;
+    json_t *json_output;
 
     output = qmi_client_dms_get_ids_finish (client, res, &error);
     if (!output) {
-        g_printerr ("error: operation failed: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "operation failed",
+             "message", error->message
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_dms_get_ids_output_get_result (output, &error)) {
-        g_printerr ("error: couldn't get IDs: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't get IDs",
+             "message", error->message
+              ));
         g_error_free (error);
         qmi_message_dms_get_ids_output_unref (output);
         shutdown (FALSE);
         return;
     }
 
-#undef VALIDATE_UNKNOWN
-#define VALIDATE_UNKNOWN(str) (str ? str : "unknown")
+    json_output = json_pack("{sbss}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device)
+              );
 
-    qmi_message_dms_get_ids_output_get_esn  (output, &esn, NULL);
-    qmi_message_dms_get_ids_output_get_imei (output, &imei, NULL);
-    qmi_message_dms_get_ids_output_get_meid (output, &meid, NULL);
+    qmicli_json_dms_get_ids_output (output, json_output);
 
-    g_print ("[%s] Device IDs retrieved:\n"
-             "\t ESN: '%s'\n"
-             "\tIMEI: '%s'\n"
-             "\tMEID: '%s'\n",
-             qmi_device_get_path_display (ctx->device),
-             VALIDATE_UNKNOWN (esn),
-             VALIDATE_UNKNOWN (imei),
-             VALIDATE_UNKNOWN (meid));
+    qmicli_output_json (json_output);
 
     qmi_message_dms_get_ids_output_unref (output);
     shutdown (TRUE);
@@ -401,64 +403,42 @@ get_capabilities_ready (QmiClientDms *client,
                         GAsyncResult *res)
 {
     QmiMessageDmsGetCapabilitiesOutput *output;
-    guint32 max_tx_channel_rate;
-    guint32 max_rx_channel_rate;
-    QmiDmsDataServiceCapability data_service_capability;
-    QmiDmsSimCapability sim_capability;
-    GArray *radio_interface_list;
     GError *error = NULL;
-    GString *networks;
-    guint i;
+    json_t *json_output;
 
     output = qmi_client_dms_get_capabilities_finish (client, res, &error);
     if (!output) {
-        g_printerr ("error: operation failed: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "operation failed",
+             "message", error->message
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_dms_get_capabilities_output_get_result (output, &error)) {
-        g_printerr ("error: couldn't get capabilities: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't get capabilities",
+             "message", error->message
+              ));
         g_error_free (error);
         qmi_message_dms_get_capabilities_output_unref (output);
         shutdown (FALSE);
         return;
     }
 
-    qmi_message_dms_get_capabilities_output_get_info (output,
-                                                      &max_tx_channel_rate,
-                                                      &max_rx_channel_rate,
-                                                      &data_service_capability,
-                                                      &sim_capability,
-                                                      &radio_interface_list,
-                                                      NULL);
+    json_output = json_pack("{sbss}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device)
+              );
 
-    networks = g_string_new ("");
-    for (i = 0; i < radio_interface_list->len; i++) {
-        g_string_append (networks,
-                         qmi_dms_radio_interface_get_string (
-                             g_array_index (radio_interface_list,
-                                            QmiDmsRadioInterface,
-                                            i)));
-        if (i != radio_interface_list->len - 1)
-            g_string_append (networks, ", ");
-    }
+    qmicli_json_dms_get_capabilities_output (output, json_output);
 
-    g_print ("[%s] Device capabilities retrieved:\n"
-             "\tMax TX channel rate: '%u'\n"
-             "\tMax RX channel rate: '%u'\n"
-             "\t       Data Service: '%s'\n"
-             "\t                SIM: '%s'\n"
-             "\t           Networks: '%s'\n",
-             qmi_device_get_path_display (ctx->device),
-             max_tx_channel_rate,
-             max_rx_channel_rate,
-             qmi_dms_data_service_capability_get_string (data_service_capability),
-             qmi_dms_sim_capability_get_string (sim_capability),
-             networks->str);
+    qmicli_output_json (json_output);
 
-    g_string_free (networks, TRUE);
     qmi_message_dms_get_capabilities_output_unref (output);
     shutdown (TRUE);
 }
@@ -467,35 +447,42 @@ static void
 get_manufacturer_ready (QmiClientDms *client,
                         GAsyncResult *res)
 {
-    const gchar *str = NULL;
     QmiMessageDmsGetManufacturerOutput *output;
     GError *error = NULL;
+    json_t *json_output;
 
     output = qmi_client_dms_get_manufacturer_finish (client, res, &error);
     if (!output) {
-        g_printerr ("error: operation failed: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "operation failed",
+             "message", error->message
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_dms_get_manufacturer_output_get_result (output, &error)) {
-        g_printerr ("error: couldn't get manufacturer: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't get manufacturer",
+             "message", error->message
+              ));
         g_error_free (error);
         qmi_message_dms_get_manufacturer_output_unref (output);
         shutdown (FALSE);
         return;
     }
 
-#undef VALIDATE_UNKNOWN
-#define VALIDATE_UNKNOWN(str) (str ? str : "unknown")
+    json_output = json_pack("{sbss}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device)
+              );
 
-    qmi_message_dms_get_manufacturer_output_get_manufacturer (output, &str, NULL);
+    qmicli_json_dms_get_manufacturer_output (output, json_output);
 
-    g_print ("[%s] Device manufacturer retrieved:\n"
-             "\tManufacturer: '%s'\n",
-             qmi_device_get_path_display (ctx->device),
-             VALIDATE_UNKNOWN (str));
+    qmicli_output_json (json_output);
 
     qmi_message_dms_get_manufacturer_output_unref (output);
     shutdown (TRUE);
@@ -505,35 +492,42 @@ static void
 get_model_ready (QmiClientDms *client,
                  GAsyncResult *res)
 {
-    const gchar *str = NULL;
     QmiMessageDmsGetModelOutput *output;
     GError *error = NULL;
+    json_t *json_output;
 
     output = qmi_client_dms_get_model_finish (client, res, &error);
     if (!output) {
-        g_printerr ("error: operation failed: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "operation failed",
+             "message", error->message
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_dms_get_model_output_get_result (output, &error)) {
-        g_printerr ("error: couldn't get model: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't get model",
+             "message", error->message
+              ));
         g_error_free (error);
         qmi_message_dms_get_model_output_unref (output);
         shutdown (FALSE);
         return;
     }
 
-#undef VALIDATE_UNKNOWN
-#define VALIDATE_UNKNOWN(str) (str ? str : "unknown")
+    json_output = json_pack("{sbss}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device)
+              );
 
-    qmi_message_dms_get_model_output_get_model (output, &str, NULL);
+    qmicli_json_dms_get_model_output (output, json_output);
 
-    g_print ("[%s] Device model retrieved:\n"
-             "\tModel: '%s'\n",
-             qmi_device_get_path_display (ctx->device),
-             VALIDATE_UNKNOWN (str));
+    qmicli_output_json (json_output);
 
     qmi_message_dms_get_model_output_unref (output);
     shutdown (TRUE);
@@ -543,35 +537,42 @@ static void
 get_revision_ready (QmiClientDms *client,
                     GAsyncResult *res)
 {
-    const gchar *str = NULL;
     QmiMessageDmsGetRevisionOutput *output;
     GError *error = NULL;
+    json_t *json_output;
 
     output = qmi_client_dms_get_revision_finish (client, res, &error);
     if (!output) {
-        g_printerr ("error: operation failed: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "operation failed",
+             "message", error->message
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_dms_get_revision_output_get_result (output, &error)) {
-        g_printerr ("error: couldn't get revision: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't get revision",
+             "message", error->message
+              ));
         g_error_free (error);
         qmi_message_dms_get_revision_output_unref (output);
         shutdown (FALSE);
         return;
     }
 
-#undef VALIDATE_UNKNOWN
-#define VALIDATE_UNKNOWN(str) (str ? str : "unknown")
+    json_output = json_pack("{sbss}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device)
+              );
 
-    qmi_message_dms_get_revision_output_get_revision (output, &str, NULL);
+    qmicli_json_dms_get_revision_output (output, json_output);
 
-    g_print ("[%s] Device revision retrieved:\n"
-             "\tRevision: '%s'\n",
-             qmi_device_get_path_display (ctx->device),
-             VALIDATE_UNKNOWN (str));
+    qmicli_output_json (json_output);
 
     qmi_message_dms_get_revision_output_unref (output);
     shutdown (TRUE);
@@ -581,35 +582,42 @@ static void
 get_msisdn_ready (QmiClientDms *client,
                   GAsyncResult *res)
 {
-    const gchar *str = NULL;
     QmiMessageDmsGetMsisdnOutput *output;
     GError *error = NULL;
+    json_t *json_output;
 
     output = qmi_client_dms_get_msisdn_finish (client, res, &error);
     if (!output) {
-        g_printerr ("error: operation failed: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "operation failed",
+             "message", error->message
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_dms_get_msisdn_output_get_result (output, &error)) {
-        g_printerr ("error: couldn't get MSISDN: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't get MSISDN",
+             "message", error->message
+              ));
         g_error_free (error);
         qmi_message_dms_get_msisdn_output_unref (output);
         shutdown (FALSE);
         return;
     }
 
-#undef VALIDATE_UNKNOWN
-#define VALIDATE_UNKNOWN(str) (str ? str : "unknown")
+    json_output = json_pack("{sbss}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device)
+              );
 
-    qmi_message_dms_get_msisdn_output_get_msisdn (output, &str, NULL);
+    qmicli_json_dms_get_msisdn_output (output, json_output);
 
-    g_print ("[%s] Device MSISDN retrieved:\n"
-             "\tMSISDN: '%s'\n",
-             qmi_device_get_path_display (ctx->device),
-             VALIDATE_UNKNOWN (str));
+    qmicli_output_json (json_output);
 
     qmi_message_dms_get_msisdn_output_unref (output);
     shutdown (TRUE);
@@ -619,42 +627,43 @@ static void
 get_power_state_ready (QmiClientDms *client,
                        GAsyncResult *res)
 {
-    gchar *power_state_str;
-    guint8 power_state_flags;
-    guint8 battery_level;
     QmiMessageDmsGetPowerStateOutput *output;
     GError *error = NULL;
+    json_t *json_output;
 
     output = qmi_client_dms_get_power_state_finish (client, res, &error);
     if (!output) {
-        g_printerr ("error: operation failed: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "operation failed",
+             "message", error->message
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_dms_get_power_state_output_get_result (output, &error)) {
-        g_printerr ("error: couldn't get power state: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't get power state",
+             "message", error->message
+              ));
         g_error_free (error);
         qmi_message_dms_get_power_state_output_unref (output);
         shutdown (FALSE);
         return;
     }
 
-    qmi_message_dms_get_power_state_output_get_info (output,
-                                                     &power_state_flags,
-                                                     &battery_level,
-                                                     NULL);
-    power_state_str = qmi_dms_power_state_build_string_from_mask ((QmiDmsPowerState)power_state_flags);
+    json_output = json_pack("{sbss}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device)
+              );
 
-    g_print ("[%s] Device power state retrieved:\n"
-             "\tPower state: '%s'\n"
-             "\tBattery level: '%u %%'\n",
-             qmi_device_get_path_display (ctx->device),
-             power_state_str,
-             (guint)battery_level);
+    qmicli_json_dms_get_power_state_output (output, json_output);
+
+    qmicli_output_json (json_output);
 
-    g_free (power_state_str);
     qmi_message_dms_get_power_state_output_unref (output);
     shutdown (TRUE);
 }
@@ -1000,62 +1009,42 @@ static void
 uim_get_pin_status_ready (QmiClientDms *client,
                           GAsyncResult *res)
 {
-    guint8 verify_retries_left;
-    guint8 unblock_retries_left;
-    QmiDmsUimPinStatus current_status;
     QmiMessageDmsUimGetPinStatusOutput *output;
     GError *error = NULL;
+    json_t *json_output;
 
     output = qmi_client_dms_uim_get_pin_status_finish (client, res, &error);
     if (!output) {
-        g_printerr ("error: operation failed: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "operation failed",
+             "message", error->message
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_dms_uim_get_pin_status_output_get_result (output, &error)) {
-        g_printerr ("error: couldn't get PIN status: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't get PIN status",
+             "message", error->message
+              ));
         g_error_free (error);
         qmi_message_dms_uim_get_pin_status_output_unref (output);
         shutdown (FALSE);
         return;
     }
 
-    g_print ("[%s] PIN status retrieved successfully\n",
-             qmi_device_get_path_display (ctx->device));
+    json_output = json_pack("{sbss}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device)
+              );
 
-    if (qmi_message_dms_uim_get_pin_status_output_get_pin1_status (
-            output,
-            &current_status,
-            &verify_retries_left,
-            &unblock_retries_left,
-            NULL)) {
-        g_print ("[%s] PIN1:\n"
-                 "\tStatus: %s\n"
-                 "\tVerify: %u\n"
-                 "\tUnblock: %u\n",
-                 qmi_device_get_path_display (ctx->device),
-                 qmi_dms_uim_pin_status_get_string (current_status),
-                 verify_retries_left,
-                 unblock_retries_left);
-    }
-
-    if (qmi_message_dms_uim_get_pin_status_output_get_pin2_status (
-            output,
-            &current_status,
-            &verify_retries_left,
-            &unblock_retries_left,
-            NULL)) {
-        g_print ("[%s] PIN2:\n"
-                 "\tStatus: %s\n"
-                 "\tVerify: %u\n"
-                 "\tUnblock: %u\n",
-                 qmi_device_get_path_display (ctx->device),
-                 qmi_dms_uim_pin_status_get_string (current_status),
-                 verify_retries_left,
-                 unblock_retries_left);
-    }
+    qmicli_json_dms_uim_get_pin_status_output (output, json_output);
+
+    qmicli_output_json (json_output);
 
     qmi_message_dms_uim_get_pin_status_output_unref (output);
     shutdown (TRUE);
@@ -1065,35 +1054,42 @@ static void
 uim_get_iccid_ready (QmiClientDms *client,
                      GAsyncResult *res)
 {
-    const gchar *str = NULL;
     QmiMessageDmsUimGetIccidOutput *output;
     GError *error = NULL;
+    json_t *json_output;
 
     output = qmi_client_dms_uim_get_iccid_finish (client, res, &error);
     if (!output) {
-        g_printerr ("error: operation failed: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "operation failed",
+             "message", error->message
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_dms_uim_get_iccid_output_get_result (output, &error)) {
-        g_printerr ("error: couldn't get ICCID: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't get ICCID",
+             "message", error->message
+              ));
         g_error_free (error);
         qmi_message_dms_uim_get_iccid_output_unref (output);
         shutdown (FALSE);
         return;
     }
 
-#undef VALIDATE_UNKNOWN
-#define VALIDATE_UNKNOWN(str) (str ? str : "unknown")
+    json_output = json_pack("{sbss}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device)
+              );
 
-    qmi_message_dms_uim_get_iccid_output_get_iccid (output, &str, NULL);
+    qmicli_json_dms_uim_get_iccid_output (output, json_output);
 
-    g_print ("[%s] UIM ICCID retrieved:\n"
-             "\tICCID: '%s'\n",
-             qmi_device_get_path_display (ctx->device),
-             VALIDATE_UNKNOWN (str));
+    qmicli_output_json (json_output);
 
     qmi_message_dms_uim_get_iccid_output_unref (output);
     shutdown (TRUE);
@@ -1103,35 +1099,42 @@ static void
 uim_get_imsi_ready (QmiClientDms *client,
                     GAsyncResult *res)
 {
-    const gchar *str = NULL;
     QmiMessageDmsUimGetImsiOutput *output;
     GError *error = NULL;
+    json_t *json_output;
 
     output = qmi_client_dms_uim_get_imsi_finish (client, res, &error);
     if (!output) {
-        g_printerr ("error: operation failed: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "operation failed",
+             "message", error->message
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_dms_uim_get_imsi_output_get_result (output, &error)) {
-        g_printerr ("error: couldn't get IMSI: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't get IMSI",
+             "message", error->message
+              ));
         g_error_free (error);
         qmi_message_dms_uim_get_imsi_output_unref (output);
         shutdown (FALSE);
         return;
     }
 
-#undef VALIDATE_UNKNOWN
-#define VALIDATE_UNKNOWN(str) (str ? str : "unknown")
+    json_output = json_pack("{sbss}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device)
+              );
 
-    qmi_message_dms_uim_get_imsi_output_get_imsi (output, &str, NULL);
+    qmicli_json_dms_uim_get_imsi_output (output, json_output);
 
-    g_print ("[%s] UIM IMSI retrieved:\n"
-             "\tIMSI: '%s'\n",
-             qmi_device_get_path_display (ctx->device),
-             VALIDATE_UNKNOWN (str));
+    qmicli_output_json (json_output);
 
     qmi_message_dms_uim_get_imsi_output_unref (output);
     shutdown (TRUE);
@@ -1141,32 +1144,42 @@ static void
 uim_get_state_ready (QmiClientDms *client,
                     GAsyncResult *res)
 {
-    QmiDmsUimState state;
     QmiMessageDmsUimGetStateOutput *output;
     GError *error = NULL;
+    json_t *json_output;
 
     output = qmi_client_dms_uim_get_state_finish (client, res, &error);
     if (!output) {
-        g_printerr ("error: operation failed: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "operation failed",
+             "message", error->message
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_dms_uim_get_state_output_get_result (output, &error)) {
-        g_printerr ("error: couldn't get UIM state: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't get UIM state",
+             "message", error->message
+              ));
         g_error_free (error);
         qmi_message_dms_uim_get_state_output_unref (output);
         shutdown (FALSE);
         return;
     }
 
-    qmi_message_dms_uim_get_state_output_get_state (output, &state, NULL);
+    json_output = json_pack("{sbss}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device)
+              );
 
-    g_print ("[%s] UIM state retrieved:\n"
-             "\tState: '%s'\n",
-             qmi_device_get_path_display (ctx->device),
-             qmi_dms_uim_state_get_string (state));
+    qmicli_json_dms_uim_get_state_output (output, json_output);
+
+    qmicli_output_json (json_output);
 
     qmi_message_dms_uim_get_state_output_unref (output);
     shutdown (TRUE);
@@ -1424,35 +1437,42 @@ static void
 get_hardware_revision_ready (QmiClientDms *client,
                              GAsyncResult *res)
 {
-    const gchar *str = NULL;
     QmiMessageDmsGetHardwareRevisionOutput *output;
     GError *error = NULL;
+    json_t *json_output;
 
     output = qmi_client_dms_get_hardware_revision_finish (client, res, &error);
     if (!output) {
-        g_printerr ("error: operation failed: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "operation failed",
+             "message", error->message
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_dms_get_hardware_revision_output_get_result (output, &error)) {
-        g_printerr ("error: couldn't get the HW revision: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't get the HW revision",
+             "message", error->message
+              ));
         g_error_free (error);
         qmi_message_dms_get_hardware_revision_output_unref (output);
         shutdown (FALSE);
         return;
     }
 
-#undef VALIDATE_UNKNOWN
-#define VALIDATE_UNKNOWN(str) (str ? str : "unknown")
+    json_output = json_pack("{sbss}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device)
+              );
 
-    qmi_message_dms_get_hardware_revision_output_get_revision (output, &str, NULL);
+    qmicli_json_dms_get_hardware_revision_output (output, json_output);
 
-    g_print ("[%s] Hardware revision retrieved:\n"
-             "\tRevision: '%s'\n",
-             qmi_device_get_path_display (ctx->device),
-             VALIDATE_UNKNOWN (str));
+    qmicli_output_json (json_output);
 
     qmi_message_dms_get_hardware_revision_output_unref (output);
     shutdown (TRUE);
@@ -1463,50 +1483,41 @@ get_operating_mode_ready (QmiClientDms *client,
                           GAsyncResult *res)
 {
     QmiMessageDmsGetOperatingModeOutput *output;
-    QmiDmsOperatingMode mode;
-    gboolean hw_restricted = FALSE;
     GError *error = NULL;
+    json_t *json_output;
 
     output = qmi_client_dms_get_operating_mode_finish (client, res, &error);
     if (!output) {
-        g_printerr ("error: operation failed: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "operation failed",
+             "message", error->message
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_dms_get_operating_mode_output_get_result (output, &error)) {
-        g_printerr ("error: couldn't get the HW revision: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't get the operating mode",
+             "message", error->message
+              ));
         g_error_free (error);
         qmi_message_dms_get_operating_mode_output_unref (output);
         shutdown (FALSE);
         return;
     }
 
-#undef VALIDATE_UNKNOWN
-#define VALIDATE_UNKNOWN(str) (str ? str : "unknown")
-
-    qmi_message_dms_get_operating_mode_output_get_mode (output, &mode, NULL);
-
-    g_print ("[%s] Operating mode retrieved:\n"
-             "\tMode: '%s'\n",
-             qmi_device_get_path_display (ctx->device),
-             qmi_dms_operating_mode_get_string (mode));
-
-    if (mode == QMI_DMS_OPERATING_MODE_OFFLINE) {
-        QmiDmsOfflineReason reason;
-        gchar *reason_str = NULL;
+    json_output = json_pack("{sbss}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device)
+              );
 
-        if (qmi_message_dms_get_operating_mode_output_get_offline_reason (output, &reason, NULL)) {
-            reason_str = qmi_dms_offline_reason_build_string_from_mask (reason);
-        }
-
-        g_print ("\tReason: '%s'\n", VALIDATE_UNKNOWN (reason_str));
-        g_free (reason_str);
-    }
+    qmicli_json_dms_get_operating_mode_output (output, json_output);
 
-    qmi_message_dms_get_operating_mode_output_get_hardware_restricted_mode (output, &hw_restricted, NULL);
-    g_print ("\tHW restricted: '%s'\n", hw_restricted ? "yes" : "no");
+    qmicli_output_json (json_output);
 
     qmi_message_dms_get_operating_mode_output_unref (output);
     shutdown (TRUE);
@@ -1572,54 +1583,41 @@ get_time_ready (QmiClientDms *client,
                 GAsyncResult *res)
 {
     QmiMessageDmsGetTimeOutput *output;
-    guint64 time_count;
-    QmiDmsTimeSource time_source;
     GError *error = NULL;
+    json_t *json_output;
 
     output = qmi_client_dms_get_time_finish (client, res, &error);
     if (!output) {
-        g_printerr ("error: operation failed: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "operation failed",
+             "message", error->message
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_dms_get_time_output_get_result (output, &error)) {
-        g_printerr ("error: couldn't get the device time: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't get the device time",
+             "message", error->message
+              ));
         g_error_free (error);
         qmi_message_dms_get_time_output_unref (output);
         shutdown (FALSE);
         return;
     }
 
-    qmi_message_dms_get_time_output_get_device_time (
-        output,
-        &time_count,
-        &time_source,
-        NULL);
+    json_output = json_pack("{sbss}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device)
+              );
 
-    g_print ("[%s] Time retrieved:\n"
-             "\tTime count: '%" G_GUINT64_FORMAT " (x 1.25ms)'\n"
-             "\tTime source: '%s'\n",
-             qmi_device_get_path_display (ctx->device),
-             time_count,
-             qmi_dms_time_source_get_string (time_source));
+    qmicli_json_dms_get_time_output (output, json_output);
 
-    if (qmi_message_dms_get_time_output_get_system_time (
-        output,
-        &time_count,
-        NULL)){
-        g_print ("\tSystem time: '%" G_GUINT64_FORMAT " (ms)'\n",
-                 time_count);
-    }
-
-    if (qmi_message_dms_get_time_output_get_user_time (
-        output,
-        &time_count,
-        NULL)){
-        g_print ("\tUser time: '%" G_GUINT64_FORMAT " (ms)'\n",
-                 time_count);
-    }
+    qmicli_output_json (json_output);
 
     qmi_message_dms_get_time_output_unref (output);
     shutdown (TRUE);
@@ -1630,43 +1628,41 @@ get_prl_version_ready (QmiClientDms *client,
                        GAsyncResult *res)
 {
     QmiMessageDmsGetPrlVersionOutput *output;
-    guint16 prl_version;
-    gboolean prl_only;
     GError *error = NULL;
+    json_t *json_output;
 
     output = qmi_client_dms_get_prl_version_finish (client, res, &error);
     if (!output) {
-        g_printerr ("error: operation failed: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "operation failed",
+             "message", error->message
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_dms_get_prl_version_output_get_result (output, &error)) {
-        g_printerr ("error: couldn't get the PRL version: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't get the PRL version",
+             "message", error->message
+              ));
         g_error_free (error);
         qmi_message_dms_get_prl_version_output_unref (output);
         shutdown (FALSE);
         return;
     }
 
-    qmi_message_dms_get_prl_version_output_get_version (
-        output,
-        &prl_version,
-        NULL);
+    json_output = json_pack("{sbss}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device)
+              );
 
-    g_print ("[%s] PRL version retrieved:\n"
-             "\tPRL version: '%" G_GUINT16_FORMAT "'\n",
-             qmi_device_get_path_display (ctx->device),
-             prl_version);
+    qmicli_json_dms_get_prl_version_output (output, json_output);
 
-    if (qmi_message_dms_get_prl_version_output_get_prl_only_preference (
-        output,
-        &prl_only,
-        NULL)){
-        g_print ("\tPRL only preference: '%s'\n",
-                 prl_only ? "yes" : "no");
-    }
+    qmicli_output_json (json_output);
 
     qmi_message_dms_get_prl_version_output_unref (output);
     shutdown (TRUE);
@@ -1677,34 +1673,41 @@ get_activation_state_ready (QmiClientDms *client,
                             GAsyncResult *res)
 {
     QmiMessageDmsGetActivationStateOutput *output;
-    QmiDmsActivationState activation_state;
     GError *error = NULL;
+    json_t *json_output;
 
     output = qmi_client_dms_get_activation_state_finish (client, res, &error);
     if (!output) {
-        g_printerr ("error: operation failed: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "operation failed",
+             "message", error->message
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_dms_get_activation_state_output_get_result (output, &error)) {
-        g_printerr ("error: couldn't get the state of the service activation: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't get the state of the service activation",
+             "message", error->message
+              ));
         g_error_free (error);
         qmi_message_dms_get_activation_state_output_unref (output);
         shutdown (FALSE);
         return;
     }
 
-    qmi_message_dms_get_activation_state_output_get_info (
-        output,
-        &activation_state,
-        NULL);
+    json_output = json_pack("{sbss}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device)
+              );
 
-    g_print ("[%s] Activation state retrieved:\n"
-             "\tState: '%s'\n",
-             qmi_device_get_path_display (ctx->device),
-             qmi_dms_activation_state_get_string (activation_state));
+    qmicli_json_dms_get_activation_state_output (output, json_output);
+
+    qmicli_output_json (json_output);
 
     qmi_message_dms_get_activation_state_output_unref (output);
     shutdown (TRUE);
@@ -1831,34 +1834,41 @@ get_user_lock_state_ready (QmiClientDms *client,
                            GAsyncResult *res)
 {
     QmiMessageDmsGetUserLockStateOutput *output;
-    gboolean enabled;
     GError *error = NULL;
+    json_t *json_output;
 
     output = qmi_client_dms_get_user_lock_state_finish (client, res, &error);
     if (!output) {
-        g_printerr ("error: operation failed: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "operation failed",
+             "message", error->message
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_dms_get_user_lock_state_output_get_result (output, &error)) {
-        g_printerr ("error: couldn't get the state of the user lock: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't get the state of the user lock",
+             "message", error->message
+              ));
         g_error_free (error);
         qmi_message_dms_get_user_lock_state_output_unref (output);
         shutdown (FALSE);
         return;
     }
 
-    qmi_message_dms_get_user_lock_state_output_get_enabled (
-        output,
-        &enabled,
-        NULL);
+    json_output = json_pack("{sbss}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device)
+              );
 
-    g_print ("[%s] User lock state retrieved:\n"
-             "\tEnabled: '%s'\n",
-             qmi_device_get_path_display (ctx->device),
-             enabled ? "yes" : "no");
+    qmicli_json_dms_get_user_lock_state_output (output, json_output);
+
+    qmicli_output_json (json_output);
 
     qmi_message_dms_get_user_lock_state_output_unref (output);
     shutdown (TRUE);
@@ -2249,47 +2259,41 @@ get_band_capabilities_ready (QmiClientDms *client,
                              GAsyncResult *res)
 {
     QmiMessageDmsGetBandCapabilitiesOutput *output;
-    QmiDmsBandCapability band_capability;
-    QmiDmsLteBandCapability lte_band_capability;
     GError *error = NULL;
-    gchar *str;
+    json_t *json_output;
 
     output = qmi_client_dms_get_band_capabilities_finish (client, res, &error);
     if (!output) {
-        g_printerr ("error: operation failed: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "operation failed",
+             "message", error->message
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_dms_get_band_capabilities_output_get_result (output, &error)) {
-        g_printerr ("error: couldn't get band capabilities: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't get band capabilities",
+             "message", error->message
+              ));
         g_error_free (error);
         qmi_message_dms_get_band_capabilities_output_unref (output);
         shutdown (FALSE);
         return;
     }
 
-    qmi_message_dms_get_band_capabilities_output_get_band_capability (
-        output,
-        &band_capability,
-        NULL);
+    json_output = json_pack("{sbss}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device)
+              );
 
-    str = qmi_dms_band_capability_build_string_from_mask (band_capability);
-    g_print ("[%s] Device band capabilities retrieved:\n"
-             "\tBands: '%s'\n",
-             qmi_device_get_path_display (ctx->device),
-             str);
-    g_free (str);
+    qmicli_json_dms_get_band_capabilities_output (output, json_output);
 
-    if (qmi_message_dms_get_band_capabilities_output_get_lte_band_capability (
-            output,
-            &lte_band_capability,
-            NULL)) {
-        str = qmi_dms_lte_band_capability_build_string_from_mask (lte_band_capability);
-        g_print ("\tLTE bands: '%s'\n", str);
-        g_free (str);
-    }
+    qmicli_output_json (json_output);
 
     qmi_message_dms_get_band_capabilities_output_unref (output);
     shutdown (TRUE);
@@ -2299,35 +2303,42 @@ static void
 get_factory_sku_ready (QmiClientDms *client,
                        GAsyncResult *res)
 {
-    const gchar *str = NULL;
     QmiMessageDmsGetFactorySkuOutput *output;
     GError *error = NULL;
+    json_t *json_output;
 
     output = qmi_client_dms_get_factory_sku_finish (client, res, &error);
     if (!output) {
-        g_printerr ("error: operation failed: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "operation failed",
+             "message", error->message
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_dms_get_factory_sku_output_get_result (output, &error)) {
-        g_printerr ("error: couldn't get factory SKU: %s\n", error->message);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't get factory SKU",
+             "message", error->message
+              ));
         g_error_free (error);
         qmi_message_dms_get_factory_sku_output_unref (output);
         shutdown (FALSE);
         return;
     }
 
-#undef VALIDATE_UNKNOWN
-#define VALIDATE_UNKNOWN(str) (str ? str : "unknown")
+    json_output = json_pack("{sbss}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device)
+              );
 
-    qmi_message_dms_get_factory_sku_output_get_sku (output, &str, NULL);
+    qmicli_json_dms_get_factory_sku_output (output, json_output);
 
-    g_print ("[%s] Device factory SKU retrieved:\n"
-             "\tSKU: '%s'\n",
-             qmi_device_get_path_display (ctx->device),
-             VALIDATE_UNKNOWN (str));
+    qmicli_output_json (json_output);
 
     qmi_message_dms_get_factory_sku_output_unref (output);
     shutdown (TRUE);
@@ -2511,7 +2522,7 @@ get_image_info (ListImagesContext *operation_ctx)
 
     qmi_client_dms_get_stored_image_info (ctx->client,
                                           input,
-                                          10,
+                                          qmicli_request_timeout (ctx->request, 10),
                                           ctx->cancellable,
                                           (GAsyncReadyCallback)get_stored_image_info_ready,
                                           operation_ctx);
@@ -2746,7 +2757,7 @@ get_stored_image (QmiClientDms *client,
     qmi_client_dms_list_stored_images (
         ctx->client,
         NULL,
-        10,
+        qmicli_request_timeout (ctx->request, 10),
         ctx->cancellable,
         (GAsyncReadyCallback)get_stored_image_list_stored_images_ready,
         operation_ctx);
@@ -2828,8 +2839,8 @@ get_stored_image_select_ready (QmiClientDms *client,
     qmi_client_dms_set_firmware_preference (
         client,
         input,
-        10,
-        NULL,
+        qmicli_request_timeout (ctx->request, 10),
+        ctx->cancellable,
         (GAsyncReadyCallback)select_stored_image_ready,
         NULL);
     qmi_message_dms_set_firmware_preference_input_unref (input);
@@ -2910,8 +2921,8 @@ get_stored_image_delete_ready (QmiClientDms *client,
     qmi_client_dms_delete_stored_image (
         client,
         input,
-        10,
-        NULL,
+        qmicli_request_timeout (ctx->request, 10),
+        ctx->cancellable,
         (GAsyncReadyCallback)delete_stored_image_ready,
         NULL);
     qmi_message_dms_delete_stored_image_input_unref (input);
@@ -2970,15 +2981,15 @@ qmicli_dms_run (QmiDevice *device,
     ctx = g_slice_new (Context);
     ctx->device = g_object_ref (device);
     ctx->client = g_object_ref (client);
-    if (cancellable)
-        ctx->cancellable = g_object_ref (cancellable);
+    ctx->request = qmicli_request_new (cancellable, qmicli_get_deadline ());
+    ctx->cancellable = g_object_ref (qmicli_request_get_cancellable (ctx->request));
 
     /* Request to get IDs? */
     if (get_ids_flag) {
         g_debug ("Asynchronously getting IDs...");
         qmi_client_dms_get_ids (ctx->client,
                                 NULL,
-                                10,
+                                qmicli_request_timeout (ctx->request, 10),
                                 ctx->cancellable,
                                 (GAsyncReadyCallback)get_ids_ready,
                                 NULL);
@@ -2990,7 +3001,7 @@ qmicli_dms_run (QmiDevice *device,
         g_debug ("Asynchronously getting capabilities...");
         qmi_client_dms_get_capabilities (ctx->client,
                                          NULL,
-                                         10,
+                                         qmicli_request_timeout (ctx->request, 10),
                                          ctx->cancellable,
                                          (GAsyncReadyCallback)get_capabilities_ready,
                                          NULL);
@@ -3002,7 +3013,7 @@ qmicli_dms_run (QmiDevice *device,
         g_debug ("Asynchronously getting manufacturer...");
         qmi_client_dms_get_manufacturer (ctx->client,
                                          NULL,
-                                         10,
+                                         qmicli_request_timeout (ctx->request, 10),
                                          ctx->cancellable,
                                          (GAsyncReadyCallback)get_manufacturer_ready,
                                          NULL);
@@ -3014,7 +3025,7 @@ qmicli_dms_run (QmiDevice *device,
         g_debug ("Asynchronously getting model...");
         qmi_client_dms_get_model (ctx->client,
                                   NULL,
-                                  10,
+                                  qmicli_request_timeout (ctx->request, 10),
                                   ctx->cancellable,
                                   (GAsyncReadyCallback)get_model_ready,
                                   NULL);
@@ -3026,7 +3037,7 @@ qmicli_dms_run (QmiDevice *device,
         g_debug ("Asynchronously getting revision...");
         qmi_client_dms_get_revision (ctx->client,
                                      NULL,
-                                     10,
+                                     qmicli_request_timeout (ctx->request, 10),
                                      ctx->cancellable,
                                      (GAsyncReadyCallback)get_revision_ready,
                                      NULL);
@@ -3038,7 +3049,7 @@ qmicli_dms_run (QmiDevice *device,
         g_debug ("Asynchronously getting msisdn...");
         qmi_client_dms_get_msisdn (ctx->client,
                                    NULL,
-                                   10,
+                                   qmicli_request_timeout (ctx->request, 10),
                                    ctx->cancellable,
                                    (GAsyncReadyCallback)get_msisdn_ready,
                                    NULL);
@@ -3050,7 +3061,7 @@ qmicli_dms_run (QmiDevice *device,
         g_debug ("Asynchronously getting power status...");
         qmi_client_dms_get_power_state (ctx->client,
                                         NULL,
-                                        10,
+                                        qmicli_request_timeout (ctx->request, 10),
                                         ctx->cancellable,
                                         (GAsyncReadyCallback)get_power_state_ready,
                                         NULL);
@@ -3069,7 +3080,7 @@ qmicli_dms_run (QmiDevice *device,
         }
         qmi_client_dms_uim_set_pin_protection (ctx->client,
                                                input,
-                                               10,
+                                               qmicli_request_timeout (ctx->request, 10),
                                                ctx->cancellable,
                                                (GAsyncReadyCallback)uim_set_pin_protection_ready,
                                                NULL);
@@ -3089,7 +3100,7 @@ qmicli_dms_run (QmiDevice *device,
         }
         qmi_client_dms_uim_verify_pin (ctx->client,
                                        input,
-                                       10,
+                                       qmicli_request_timeout (ctx->request, 10),
                                        ctx->cancellable,
                                        (GAsyncReadyCallback)uim_verify_pin_ready,
                                        NULL);
@@ -3109,7 +3120,7 @@ qmicli_dms_run (QmiDevice *device,
         }
         qmi_client_dms_uim_unblock_pin (ctx->client,
                                         input,
-                                        10,
+                                        qmicli_request_timeout (ctx->request, 10),
                                         ctx->cancellable,
                                         (GAsyncReadyCallback)uim_unblock_pin_ready,
                                         NULL);
@@ -3129,7 +3140,7 @@ qmicli_dms_run (QmiDevice *device,
         }
         qmi_client_dms_uim_change_pin (ctx->client,
                                        input,
-                                       10,
+                                       qmicli_request_timeout (ctx->request, 10),
                                        ctx->cancellable,
                                        (GAsyncReadyCallback)uim_change_pin_ready,
                                        NULL);
@@ -3142,7 +3153,7 @@ qmicli_dms_run (QmiDevice *device,
         g_debug ("Asynchronously getting PIN status...");
         qmi_client_dms_uim_get_pin_status (ctx->client,
                                            NULL,
-                                           10,
+                                           qmicli_request_timeout (ctx->request, 10),
                                            ctx->cancellable,
                                            (GAsyncReadyCallback)uim_get_pin_status_ready,
                                            NULL);
@@ -3154,7 +3165,7 @@ qmicli_dms_run (QmiDevice *device,
         g_debug ("Asynchronously getting UIM ICCID...");
         qmi_client_dms_uim_get_iccid (ctx->client,
                                       NULL,
-                                      10,
+                                      qmicli_request_timeout (ctx->request, 10),
                                       ctx->cancellable,
                                       (GAsyncReadyCallback)uim_get_iccid_ready,
                                       NULL);
@@ -3166,7 +3177,7 @@ qmicli_dms_run (QmiDevice *device,
         g_debug ("Asynchronously getting UIM IMSI...");
         qmi_client_dms_uim_get_imsi (ctx->client,
                                      NULL,
-                                     10,
+                                     qmicli_request_timeout (ctx->request, 10),
                                      ctx->cancellable,
                                      (GAsyncReadyCallback)uim_get_imsi_ready,
                                      NULL);
@@ -3178,7 +3189,7 @@ qmicli_dms_run (QmiDevice *device,
         g_debug ("Asynchronously getting UIM state...");
         qmi_client_dms_uim_get_state (ctx->client,
                                       NULL,
-                                      10,
+                                      qmicli_request_timeout (ctx->request, 10),
                                       ctx->cancellable,
                                       (GAsyncReadyCallback)uim_get_state_ready,
                                       NULL);
@@ -3190,7 +3201,7 @@ qmicli_dms_run (QmiDevice *device,
         g_debug ("Asynchronously getting hardware revision...");
         qmi_client_dms_get_hardware_revision (ctx->client,
                                               NULL,
-                                              10,
+                                              qmicli_request_timeout (ctx->request, 10),
                                               ctx->cancellable,
                                               (GAsyncReadyCallback)get_hardware_revision_ready,
                                               NULL);
@@ -3202,7 +3213,7 @@ qmicli_dms_run (QmiDevice *device,
         g_debug ("Asynchronously getting operating mode...");
         qmi_client_dms_get_operating_mode (ctx->client,
                                            NULL,
-                                           10,
+                                           qmicli_request_timeout (ctx->request, 10),
                                            ctx->cancellable,
                                            (GAsyncReadyCallback)get_operating_mode_ready,
                                            NULL);
@@ -3221,7 +3232,7 @@ qmicli_dms_run (QmiDevice *device,
         }
         qmi_client_dms_set_operating_mode (ctx->client,
                                            input,
-                                           10,
+                                           qmicli_request_timeout (ctx->request, 10),
                                            ctx->cancellable,
                                            (GAsyncReadyCallback)set_operating_mode_ready,
                                            NULL);
@@ -3234,7 +3245,7 @@ qmicli_dms_run (QmiDevice *device,
         g_debug ("Asynchronously getting time...");
         qmi_client_dms_get_time (ctx->client,
                                  NULL,
-                                 10,
+                                 qmicli_request_timeout (ctx->request, 10),
                                  ctx->cancellable,
                                  (GAsyncReadyCallback)get_time_ready,
                                  NULL);
@@ -3246,7 +3257,7 @@ qmicli_dms_run (QmiDevice *device,
         g_debug ("Asynchronously getting PRL version...");
         qmi_client_dms_get_prl_version (ctx->client,
                                         NULL,
-                                        10,
+                                        qmicli_request_timeout (ctx->request, 10),
                                         ctx->cancellable,
                                         (GAsyncReadyCallback)get_prl_version_ready,
                                         NULL);
@@ -3258,7 +3269,7 @@ qmicli_dms_run (QmiDevice *device,
         g_debug ("Asynchronously getting activation state...");
         qmi_client_dms_get_activation_state (ctx->client,
                                              NULL,
-                                             10,
+                                             qmicli_request_timeout (ctx->request, 10),
                                              ctx->cancellable,
                                              (GAsyncReadyCallback)get_activation_state_ready,
                                              NULL);
@@ -3277,7 +3288,7 @@ qmicli_dms_run (QmiDevice *device,
         }
         qmi_client_dms_activate_automatic (ctx->client,
                                            input,
-                                           10,
+                                           qmicli_request_timeout (ctx->request, 10),
                                            ctx->cancellable,
                                            (GAsyncReadyCallback)activate_automatic_ready,
                                            NULL);
@@ -3297,7 +3308,7 @@ qmicli_dms_run (QmiDevice *device,
         }
         qmi_client_dms_activate_manual (ctx->client,
                                         input,
-                                        10,
+                                        qmicli_request_timeout (ctx->request, 10),
                                         ctx->cancellable,
                                         (GAsyncReadyCallback)activate_manual_ready,
                                         NULL);
@@ -3310,7 +3321,7 @@ qmicli_dms_run (QmiDevice *device,
         g_debug ("Asynchronously getting user lock state...");
         qmi_client_dms_get_user_lock_state (ctx->client,
                                             NULL,
-                                            10,
+                                            qmicli_request_timeout (ctx->request, 10),
                                             ctx->cancellable,
                                             (GAsyncReadyCallback)get_user_lock_state_ready,
                                             NULL);
@@ -3329,7 +3340,7 @@ qmicli_dms_run (QmiDevice *device,
         }
         qmi_client_dms_set_user_lock_state (ctx->client,
                                             input,
-                                            10,
+                                            qmicli_request_timeout (ctx->request, 10),
                                             ctx->cancellable,
                                             (GAsyncReadyCallback)set_user_lock_state_ready,
                                             NULL);
@@ -3349,7 +3360,7 @@ qmicli_dms_run (QmiDevice *device,
         }
         qmi_client_dms_set_user_lock_code (ctx->client,
                                            input,
-                                           10,
+                                           qmicli_request_timeout (ctx->request, 10),
                                            ctx->cancellable,
                                            (GAsyncReadyCallback)set_user_lock_code_ready,
                                             NULL);
@@ -3362,7 +3373,7 @@ qmicli_dms_run (QmiDevice *device,
         g_debug ("Asynchronously reading user data...");
         qmi_client_dms_read_user_data (ctx->client,
                                        NULL,
-                                       10,
+                                       qmicli_request_timeout (ctx->request, 10),
                                        ctx->cancellable,
                                        (GAsyncReadyCallback)read_user_data_ready,
                                        NULL);
@@ -3381,7 +3392,7 @@ qmicli_dms_run (QmiDevice *device,
         }
         qmi_client_dms_write_user_data (ctx->client,
                                         input,
-                                        10,
+                                        qmicli_request_timeout (ctx->request, 10),
                                         ctx->cancellable,
                                         (GAsyncReadyCallback)write_user_data_ready,
                                         NULL);
@@ -3394,7 +3405,7 @@ qmicli_dms_run (QmiDevice *device,
         g_debug ("Asynchronously reading ERI file...");
         qmi_client_dms_read_eri_file (ctx->client,
                                       NULL,
-                                      10,
+                                      qmicli_request_timeout (ctx->request, 10),
                                       ctx->cancellable,
                                       (GAsyncReadyCallback)read_eri_file_ready,
                                       NULL);
@@ -3413,7 +3424,7 @@ qmicli_dms_run (QmiDevice *device,
         }
         qmi_client_dms_restore_factory_defaults (ctx->client,
                                                  input,
-                                                 10,
+                                                 qmicli_request_timeout (ctx->request, 10),
                                                  ctx->cancellable,
                                                  (GAsyncReadyCallback)restore_factory_defaults_ready,
                                                  NULL);
@@ -3433,7 +3444,7 @@ qmicli_dms_run (QmiDevice *device,
         }
         qmi_client_dms_validate_service_programming_code (ctx->client,
                                                           input,
-                                                          10,
+                                                          qmicli_request_timeout (ctx->request, 10),
                                                           ctx->cancellable,
                                                           (GAsyncReadyCallback)validate_service_programming_code_ready,
                                                           NULL);
@@ -3453,7 +3464,7 @@ qmicli_dms_run (QmiDevice *device,
         }
         qmi_client_dms_uim_get_ck_status (ctx->client,
                                           input,
-                                          10,
+                                          qmicli_request_timeout (ctx->request, 10),
                                           ctx->cancellable,
                                           (GAsyncReadyCallback)uim_get_ck_status_ready,
                                           NULL);
@@ -3473,7 +3484,7 @@ qmicli_dms_run (QmiDevice *device,
         }
         qmi_client_dms_uim_set_ck_protection (ctx->client,
                                               input,
-                                              10,
+                                              qmicli_request_timeout (ctx->request, 10),
                                               ctx->cancellable,
                                               (GAsyncReadyCallback)uim_set_ck_protection_ready,
                                               NULL);
@@ -3493,7 +3504,7 @@ qmicli_dms_run (QmiDevice *device,
         }
         qmi_client_dms_uim_unblock_ck (ctx->client,
                                        input,
-                                       10,
+                                       qmicli_request_timeout (ctx->request, 10),
                                        ctx->cancellable,
                                        (GAsyncReadyCallback)uim_unblock_ck_ready,
                                        NULL);
@@ -3506,7 +3517,7 @@ qmicli_dms_run (QmiDevice *device,
         g_debug ("Asynchronously getting band capabilities...");
         qmi_client_dms_get_band_capabilities (ctx->client,
                                               NULL,
-                                              10,
+                                              qmicli_request_timeout (ctx->request, 10),
                                               ctx->cancellable,
                                               (GAsyncReadyCallback)get_band_capabilities_ready,
                                               NULL);
@@ -3518,7 +3529,7 @@ qmicli_dms_run (QmiDevice *device,
         g_debug ("Asynchronously getting factory SKU...");
         qmi_client_dms_get_factory_sku (ctx->client,
                                         NULL,
-                                        10,
+                                        qmicli_request_timeout (ctx->request, 10),
                                         ctx->cancellable,
                                         (GAsyncReadyCallback)get_factory_sku_ready,
                                         NULL);
@@ -3530,7 +3541,7 @@ qmicli_dms_run (QmiDevice *device,
         g_debug ("Asynchronously listing stored images...");
         qmi_client_dms_list_stored_images (ctx->client,
                                            NULL,
-                                           10,
+                                           qmicli_request_timeout (ctx->request, 10),
                                            ctx->cancellable,
                                            (GAsyncReadyCallback)list_stored_images_ready,
                                            NULL);
@@ -3562,7 +3573,7 @@ qmicli_dms_run (QmiDevice *device,
         g_debug ("Asynchronously resetting DMS service...");
         qmi_client_dms_reset (ctx->client,
                               NULL,
-                              10,
+                              qmicli_request_timeout (ctx->request, 10),
                               ctx->cancellable,
                               (GAsyncReadyCallback)reset_ready,
                               NULL);
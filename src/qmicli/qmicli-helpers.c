@@ -103,6 +103,25 @@ qmicli_get_raw_data_printable (const GArray *data,
 	return new_str;
 }
 
+gdouble
+qmicli_get_db_from_sinr_level (QmiNasEvdoSinrLevel level)
+{
+    switch (level) {
+    case QMI_NAS_EVDO_SINR_LEVEL_0: return -9.0;
+    case QMI_NAS_EVDO_SINR_LEVEL_1: return -6;
+    case QMI_NAS_EVDO_SINR_LEVEL_2: return -4.5;
+    case QMI_NAS_EVDO_SINR_LEVEL_3: return -3;
+    case QMI_NAS_EVDO_SINR_LEVEL_4: return -2;
+    case QMI_NAS_EVDO_SINR_LEVEL_5: return 1;
+    case QMI_NAS_EVDO_SINR_LEVEL_6: return 3;
+    case QMI_NAS_EVDO_SINR_LEVEL_7: return 6;
+    case QMI_NAS_EVDO_SINR_LEVEL_8: return +9;
+    default:
+        g_warning ("Invalid SINR level '%u'", level);
+        return -G_MAXDOUBLE;
+    }
+}
+
 gboolean
 qmicli_read_pin_id_from_string (const gchar *str,
                                 QmiDmsUimPinId *out)
@@ -184,6 +203,49 @@ qmicli_read_rat_mode_pref_from_string (const gchar *str,
     return success && set;
 }
 
+gboolean
+qmicli_read_network_scan_type_from_string (const gchar *str,
+                                           QmiNasNetworkScanType *out)
+{
+    GType type;
+    GFlagsClass *flags_class;
+    GFlagsValue *flags_value;
+    gboolean success = TRUE, set = FALSE;
+    char **items, **iter;
+
+    type = qmi_nas_network_scan_type_get_type ();
+    flags_class = G_FLAGS_CLASS (g_type_class_ref (type));
+
+    items = g_strsplit_set (str, "|", 0);
+    for (iter = items; iter && *iter && success; iter++) {
+        gchar *c;
+
+        /* Nicks are lowercase; be lenient with " LTE | UMTS " */
+        g_strstrip (*iter);
+        if (!*iter[0])
+            continue;
+        for (c = *iter; *c; c++)
+            *c = g_ascii_tolower (*c);
+
+        flags_value = g_flags_get_value_by_nick (flags_class, *iter);
+        if (flags_value) {
+            *out |= (QmiNasNetworkScanType)flags_value->value;
+            set = TRUE;
+        } else {
+            g_printerr ("error: invalid network scan type value given: '%s'\n", *iter);
+            success = FALSE;
+        }
+    }
+
+    if (!set)
+        g_printerr ("error: invalid network scan type input given: '%s'\n", str);
+
+    if (items)
+        g_strfreev (items);
+    g_type_class_unref (flags_class);
+    return success && set;
+}
+
 gboolean
 qmicli_read_facility_from_string (const gchar *str,
                                   QmiDmsUimFacility *out)
@@ -368,3 +430,318 @@ qmicli_read_uint_from_string (const gchar *str,
     }
     return FALSE;
 }
+
+/*****************************************************************************/
+/* Counter groups accepted by --wds-get-packet-statistics */
+static const struct {
+    const gchar *name;
+    QmiWdsPacketStatisticsMaskFlag mask;
+} packet_statistics_groups[] = {
+    { "packets",   (QMI_WDS_PACKET_STATISTICS_MASK_FLAG_TX_PACKETS_OK |
+                    QMI_WDS_PACKET_STATISTICS_MASK_FLAG_RX_PACKETS_OK) },
+    { "errors",    (QMI_WDS_PACKET_STATISTICS_MASK_FLAG_TX_PACKETS_ERROR |
+                    QMI_WDS_PACKET_STATISTICS_MASK_FLAG_RX_PACKETS_ERROR) },
+    { "overflows", (QMI_WDS_PACKET_STATISTICS_MASK_FLAG_TX_OVERFLOWS |
+                    QMI_WDS_PACKET_STATISTICS_MASK_FLAG_RX_OVERFLOWS) },
+    { "bytes",     (QMI_WDS_PACKET_STATISTICS_MASK_FLAG_TX_BYTES_OK |
+                    QMI_WDS_PACKET_STATISTICS_MASK_FLAG_RX_BYTES_OK) },
+    { "drops",     (QMI_WDS_PACKET_STATISTICS_MASK_FLAG_TX_PACKETS_DROPPED |
+                    QMI_WDS_PACKET_STATISTICS_MASK_FLAG_RX_PACKETS_DROPPED) },
+};
+
+gboolean
+qmicli_read_packet_statistics_mask_from_string (const gchar *str,
+                                                QmiWdsPacketStatisticsMaskFlag *out)
+{
+    QmiWdsPacketStatisticsMaskFlag mask = 0;
+    gchar **items;
+    guint i, j;
+
+    /* No groups given, get them all */
+    if (!str || !str[0] || g_str_equal (str, "all")) {
+        for (j = 0; j < G_N_ELEMENTS (packet_statistics_groups); j++)
+            mask |= packet_statistics_groups[j].mask;
+        *out = mask;
+        return TRUE;
+    }
+
+    items = g_strsplit (str, ",", -1);
+    for (i = 0; items[i]; i++) {
+        const gchar *item;
+
+        item = g_strstrip (items[i]);
+        for (j = 0; j < G_N_ELEMENTS (packet_statistics_groups); j++) {
+            if (g_ascii_strcasecmp (item, packet_statistics_groups[j].name) == 0) {
+                mask |= packet_statistics_groups[j].mask;
+                break;
+            }
+        }
+
+        if (j == G_N_ELEMENTS (packet_statistics_groups)) {
+            g_printerr ("error: invalid packet statistics group given: '%s'\n", item);
+            g_strfreev (items);
+            return FALSE;
+        }
+    }
+    g_strfreev (items);
+
+    *out = mask;
+    return TRUE;
+}
+
+/* Field projection */
+
+struct _QmicliFields {
+    gchar **selectors;
+};
+
+gboolean
+qmicli_read_fields_from_string (const gchar *str,
+                                QmicliFields **out)
+{
+    GPtrArray *selectors;
+    gchar **items;
+    guint i;
+
+    if (!str || !str[0]) {
+        g_printerr ("error: expected a comma-separated list of fields, got: none\n");
+        return FALSE;
+    }
+
+    selectors = g_ptr_array_new ();
+    items = g_strsplit (str, ",", -1);
+    for (i = 0; items[i]; i++) {
+        const gchar *selector;
+
+        selector = g_strstrip (items[i]);
+
+        /* jq-style leading dot is optional */
+        if (selector[0] == '.')
+            selector++;
+
+        if (!selector[0] ||
+            selector[strlen (selector) - 1] == '.' ||
+            strstr (selector, "..")) {
+            g_printerr ("error: invalid field given: '%s'\n", items[i]);
+            g_ptr_array_add (selectors, NULL);
+            g_strfreev ((gchar **)g_ptr_array_free (selectors, FALSE));
+            g_strfreev (items);
+            return FALSE;
+        }
+
+        g_ptr_array_add (selectors, g_strdup (selector));
+    }
+    g_ptr_array_add (selectors, NULL);
+    g_strfreev (items);
+
+    *out = g_slice_new (QmicliFields);
+    (*out)->selectors = (gchar **)g_ptr_array_free (selectors, FALSE);
+    return TRUE;
+}
+
+void
+qmicli_fields_free (QmicliFields *fields)
+{
+    if (!fields)
+        return;
+    g_strfreev (fields->selectors);
+    g_slice_free (QmicliFields, fields);
+}
+
+/* '_' in a selector stands for the spaces used in our keys */
+static inline gboolean
+field_char_equal (gchar a,
+                  gchar b)
+{
+    if (a == '_')
+        a = ' ';
+    if (b == '_')
+        b = ' ';
+    return g_ascii_tolower (a) == g_ascii_tolower (b);
+}
+
+static gboolean
+selector_match (const gchar *selector,
+                const gchar *path)
+{
+    while (*selector && *path) {
+        if (!field_char_equal (*selector, *path))
+            return FALSE;
+        selector++;
+        path++;
+    }
+
+    /* Either the whole path was selected, or the path is one of the objects
+     * leading to a selected key, or the selector covers the path's subtree */
+    return ((!*selector && !*path) ||
+            (!*selector && *path == '.') ||
+            (!*path && *selector == '.'));
+}
+
+gboolean
+qmicli_fields_match (const QmicliFields *fields,
+                     const gchar *path)
+{
+    guint i;
+
+    if (!fields || !path[0])
+        return TRUE;
+
+    for (i = 0; fields->selectors[i]; i++) {
+        if (selector_match (fields->selectors[i], path))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+gboolean
+qmicli_fields_match_any (const QmicliFields *fields,
+                         const gchar * const *paths)
+{
+    guint i;
+
+    if (!fields)
+        return TRUE;
+
+    for (i = 0; paths[i]; i++) {
+        if (qmicli_fields_match (fields, paths[i]))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* Subcommands */
+
+static gboolean
+option_takes_value (const GOptionEntry *entry)
+{
+    if (entry->arg == G_OPTION_ARG_NONE)
+        return FALSE;
+    if (entry->flags & (G_OPTION_FLAG_NO_ARG | G_OPTION_FLAG_OPTIONAL_ARG))
+        return FALSE;
+    return TRUE;
+}
+
+/* How many of the arguments at 'i' the global option there takes, or 0 if
+ * it isn't one of them */
+static gint
+global_option_skip (const GOptionEntry *globals,
+                    gchar **in,
+                    gint i)
+{
+    const GOptionEntry *entry;
+    const gchar *arg;
+
+    arg = in[i];
+    if (arg[1] == '-') {
+        const gchar *name;
+        gsize len;
+
+        name = &arg[2];
+        len = strcspn (name, "=");
+        for (entry = globals; entry->long_name; entry++) {
+            if (strlen (entry->long_name) == len &&
+                strncmp (entry->long_name, name, len) == 0)
+                break;
+        }
+        if (!entry->long_name)
+            return 0;
+        /* '--device /dev/cdc-wdm0' and '--device=/dev/cdc-wdm0' */
+        return (option_takes_value (entry) && !name[len] ? 2 : 1);
+    }
+
+    /* Short ones, maybe grouped as in '-vd /dev/cdc-wdm0' */
+    for (arg++; *arg; arg++) {
+        for (entry = globals; entry->long_name; entry++) {
+            if (entry->short_name && entry->short_name == *arg)
+                break;
+        }
+        if (!entry->long_name)
+            return 0;
+        if (option_takes_value (entry))
+            return (arg[1] ? 1 : 2);
+    }
+    return 1;
+}
+
+gboolean
+qmicli_expand_subcommand (const gchar *const *services,
+                          const GOptionEntry *globals,
+                          gint *argc,
+                          gchar ***argv,
+                          gchar **out_service)
+{
+    GPtrArray *args;
+    gchar **in;
+    const gchar *service;
+    gint first, i, skip;
+
+    in = *argv;
+
+    /* Global options may come before the service, e.g.
+     * 'qmicli -d /dev/cdc-wdm0 nas get-signal-info' */
+    for (first = 1; first < *argc && in[first][0] == '-' && in[first][1]; first += skip) {
+        if (g_str_equal (in[first], "--"))
+            return FALSE;
+        skip = global_option_skip (globals, in, first);
+        if (!skip)
+            return FALSE;
+    }
+    if (first >= *argc)
+        return FALSE;
+
+    for (i = 0; services[i]; i++) {
+        if (g_str_equal (services[i], in[first]))
+            break;
+    }
+    if (!services[i])
+        return FALSE;
+    service = in[first];
+
+    args = g_ptr_array_new ();
+    for (i = 0; i < first; i++)
+        g_ptr_array_add (args, g_strdup (in[i]));
+    i = first + 1;
+
+    /* The action is optional, so that e.g. 'qmicli wds --help' works. Its
+     * value may be given as 'action=value' too, for values that would
+     * otherwise look like an option; negative numbers are taken as is. */
+    if (i < *argc && in[i][0] != '-') {
+        if (!strchr (in[i], '=') &&
+            i + 1 < *argc &&
+            (in[i + 1][0] != '-' || g_ascii_isdigit (in[i + 1][1]))) {
+            g_ptr_array_add (args, g_strdup_printf ("--%s-%s=%s", service, in[i], in[i + 1]));
+            i += 2;
+        } else {
+            g_ptr_array_add (args, g_strdup_printf ("--%s-%s", service, in[i]));
+            i++;
+        }
+    }
+
+    for (; i < *argc; i++)
+        g_ptr_array_add (args, g_strdup (in[i]));
+
+    *out_service = g_strdup (service);
+    *argc = args->len;
+    g_ptr_array_add (args, NULL);
+    *argv = (gchar **)g_ptr_array_free (args, FALSE);
+    return TRUE;
+}
+
+/* Runtime files */
+
+/* Per-device files under the runtime dir, e.g.
+ * /dev/cdc-wdm0 -> $XDG_RUNTIME_DIR/qmicli/dev_cdc-wdm0.<suffix> */
+gchar *
+qmicli_get_runtime_file_path (const gchar *device_path,
+                              const gchar *suffix)
+{
+    gchar *name;
+    gchar *path;
+
+    name = g_strdup_printf ("%s.%s", device_path[0] == '/' ? device_path + 1 : device_path, suffix);
+    g_strdelimit (name, "/", '_');
+    path = g_build_filename (g_get_user_runtime_dir (), "qmicli", name, NULL);
+    g_free (name);
+    return path;
+}
@@ -29,12 +29,16 @@ gchar *qmicli_get_raw_data_printable (const GArray *data,
                                       gsize max_line_length,
                                       const gchar *new_line_prefix);
 
+gdouble qmicli_get_db_from_sinr_level (QmiNasEvdoSinrLevel level);
+
 gboolean qmicli_read_pin_id_from_string         (const gchar *str,
                                                  QmiDmsUimPinId *out);
 gboolean qmicli_read_operating_mode_from_string (const gchar *str,
                                                  QmiDmsOperatingMode *out);
 gboolean qmicli_read_rat_mode_pref_from_string  (const gchar *str,
                                                  QmiNasRatModePreference *out);
+gboolean qmicli_read_network_scan_type_from_string (const gchar *str,
+                                                    QmiNasNetworkScanType *out);
 gboolean qmicli_read_facility_from_string       (const gchar *str,
                                                  QmiDmsUimFacility *out);
 gboolean qmicli_read_enable_disable_from_string (const gchar *str,
@@ -46,6 +50,8 @@ gboolean qmicli_read_radio_interface_from_string (const gchar *str,
                                                   QmiNasRadioInterface *out);
 gboolean qmicli_read_net_open_flags_from_string (const gchar *str,
                                                  QmiDeviceOpenFlags *out);
+gboolean qmicli_read_packet_statistics_mask_from_string (const gchar *str,
+                                                         QmiWdsPacketStatisticsMaskFlag *out);
 
 gboolean qmicli_read_non_empty_string           (const gchar *str,
                                                  const gchar *description,
@@ -53,4 +59,27 @@ gboolean qmicli_read_non_empty_string           (const gchar *str,
 gboolean qmicli_read_uint_from_string           (const gchar *str,
                                                  guint *out);
 
+/* Field projection, from a comma-separated list of jq-style paths */
+typedef struct _QmicliFields QmicliFields;
+
+gboolean qmicli_read_fields_from_string (const gchar *str,
+                                         QmicliFields **out);
+void     qmicli_fields_free             (QmicliFields *fields);
+gboolean qmicli_fields_match            (const QmicliFields *fields,
+                                         const gchar *path);
+gboolean qmicli_fields_match_any        (const QmicliFields *fields,
+                                         const gchar * const *paths);
+
+/* 'qmicli [globals] <service> <action> [value]' to
+ * 'qmicli [globals] --<service>-<action>[=value]' */
+gboolean qmicli_expand_subcommand (const gchar *const *services,
+                                   const GOptionEntry *globals,
+                                   gint *argc,
+                                   gchar ***argv,
+                                   gchar **out_service);
+
+/* Per-device files under the runtime dir */
+gchar    *qmicli_get_runtime_file_path (const gchar *device_path,
+                                        const gchar *suffix);
+
 #endif /* __QMICLI_H__ */
@@ -0,0 +1,202 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * qmicli -- Command line interface to control QMI devices
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include <libqmi-glib.h>
+
+#include "qmicli.h"
+
+struct _QmicliHistory {
+    guint capacity;
+    guint n_columns;
+    /* Slot of the oldest sample, and number of samples */
+    guint head;
+    guint length;
+    gint64 *timestamps;
+    /* n_columns arrays of 'capacity' values each */
+    gint16 *values;
+};
+
+QmicliHistory *
+qmicli_history_new (guint capacity,
+                    guint n_columns)
+{
+    QmicliHistory *history;
+
+    g_return_val_if_fail (capacity > 0, NULL);
+
+    history = g_slice_new0 (QmicliHistory);
+    history->capacity = capacity;
+    history->n_columns = n_columns;
+    history->timestamps = g_new (gint64, capacity);
+    history->values = g_new (gint16, (gsize)capacity * n_columns);
+    return history;
+}
+
+void
+qmicli_history_free (QmicliHistory *history)
+{
+    if (!history)
+        return;
+
+    g_free (history->timestamps);
+    g_free (history->values);
+    g_slice_free (QmicliHistory, history);
+}
+
+/* Timestamps are expected not to go backwards */
+void
+qmicli_history_append (QmicliHistory *history,
+                       gint64 timestamp,
+                       const gint16 *values)
+{
+    guint slot;
+    guint i;
+
+    if (history->length < history->capacity) {
+        slot = (history->head + history->length) % history->capacity;
+        history->length++;
+    } else {
+        slot = history->head;
+        history->head = (history->head + 1) % history->capacity;
+    }
+
+    history->timestamps[slot] = timestamp;
+    for (i = 0; i < history->n_columns; i++)
+        history->values[i * history->capacity + slot] = values[i];
+}
+
+guint
+qmicli_history_get_length (QmicliHistory *history)
+{
+    return history->length;
+}
+
+/* Indices go from 0, the oldest sample, to length - 1 */
+static guint
+history_slot (QmicliHistory *history,
+              guint index)
+{
+    return (history->head + index) % history->capacity;
+}
+
+gint64
+qmicli_history_get_timestamp (QmicliHistory *history,
+                              guint index)
+{
+    g_return_val_if_fail (index < history->length, 0);
+
+    return history->timestamps[history_slot (history, index)];
+}
+
+gint16
+qmicli_history_get_value (QmicliHistory *history,
+                          guint index,
+                          guint column)
+{
+    g_return_val_if_fail (index < history->length, QMICLI_HISTORY_MISSING);
+    g_return_val_if_fail (column < history->n_columns, QMICLI_HISTORY_MISSING);
+
+    return history->values[column * history->capacity + history_slot (history, index)];
+}
+
+/* The last 'n' samples, or fewer if there aren't as many; returns how many */
+guint
+qmicli_history_last (QmicliHistory *history,
+                     guint n,
+                     guint *out_first)
+{
+    n = MIN (n, history->length);
+    *out_first = history->length - n;
+    return n;
+}
+
+/* Samples with timestamps in [from, to]; returns how many */
+guint
+qmicli_history_range (QmicliHistory *history,
+                      gint64 from,
+                      gint64 to,
+                      guint *out_first)
+{
+    guint low, high;
+    guint first;
+
+    /* First sample not before 'from' */
+    low = 0;
+    high = history->length;
+    while (low < high) {
+        guint middle = low + (high - low) / 2;
+
+        if (qmicli_history_get_timestamp (history, middle) < from)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    first = low;
+
+    /* First sample after 'to' */
+    high = history->length;
+    while (low < high) {
+        guint middle = low + (high - low) / 2;
+
+        if (qmicli_history_get_timestamp (history, middle) <= to)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    *out_first = first;
+    return low - first;
+}
+
+/* Missing values are left out; out->count is 0 if all of them are */
+void
+qmicli_history_aggregate (QmicliHistory *history,
+                          guint first,
+                          guint count,
+                          guint column,
+                          QmicliHistoryAggregate *out)
+{
+    gint64 sum = 0;
+    guint i;
+
+    g_return_if_fail (first + count <= history->length);
+    g_return_if_fail (column < history->n_columns);
+
+    memset (out, 0, sizeof (*out));
+    for (i = first; i < first + count; i++) {
+        gint16 value;
+
+        value = history->values[column * history->capacity + history_slot (history, i)];
+        if (value == QMICLI_HISTORY_MISSING)
+            continue;
+
+        if (!out->count || value < out->min)
+            out->min = value;
+        if (!out->count || value > out->max)
+            out->max = value;
+        sum += value;
+        out->count++;
+    }
+
+    if (out->count)
+        out->avg = (gdouble)sum / out->count;
+}
@@ -0,0 +1,240 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * qmicli -- Command line interface to control QMI devices
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include <libqmi-glib.h>
+
+#include <jansson.h>
+
+#include "qmicli.h"
+
+/* Every document is serialized into the same buffer and written out with a
+ * single write(), so concurrent producers never interleave their output */
+static GString *buffer;
+G_LOCK_DEFINE_STATIC (output);
+
+static int
+dump_callback (const char *data,
+               size_t size,
+               void *user_data)
+{
+    g_string_append_len ((GString *)user_data, data, size);
+    return 0;
+}
+
+static void
+write_all (const gchar *data,
+           gsize length)
+{
+    while (length > 0) {
+        gssize written;
+
+        written = write (STDOUT_FILENO, data, length);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        data += written;
+        length -= written;
+    }
+}
+
+void
+qmicli_output_json_full (json_t *document,
+                         size_t flags)
+{
+    G_LOCK (output);
+
+    if (!buffer)
+        buffer = g_string_sized_new (4096);
+    g_string_truncate (buffer, 0);
+
+    /* A NULL document is what json_pack() gives on failure */
+    if (!document || json_dump_callback (document, dump_callback, buffer, flags) < 0)
+        g_string_assign (buffer, JSON_OUTPUT_ERROR);
+    g_string_append_c (buffer, '\n');
+
+    /* Keep ordering with whatever went through stdio before */
+    fflush (stdout);
+    write_all (buffer->str, buffer->len);
+
+    G_UNLOCK (output);
+
+    if (document)
+        json_decref (document);
+}
+
+void
+qmicli_output_json (json_t *document)
+{
+    qmicli_output_json_full (document, json_print_flag);
+}
+
+/*****************************************************************************/
+/* Monitor lines as merge patches */
+
+typedef struct {
+    /* Previous document, serialized: keeping the value itself would pin
+     * the JSON arena and stop it from ever being rewound */
+    GString *previous;
+    guint samples;
+} MonitorStream;
+
+static guint monitor_keyframe;
+static GHashTable *monitor_streams;
+
+static void
+monitor_stream_free (MonitorStream *state)
+{
+    g_string_free (state->previous, TRUE);
+    g_slice_free (MonitorStream, state);
+}
+
+/* RFC 7386 merge patch turning 'from' into 'to'; an empty object if they are
+ * the same. Values which are null in 'to' can't be told from removed ones,
+ * as in any merge patch. */
+json_t *
+qmicli_json_merge_diff (json_t *from,
+                        json_t *to)
+{
+    json_t *patch;
+    json_t *value;
+    const char *key;
+
+    if (!json_is_object (from) || !json_is_object (to))
+        return json_deep_copy (to);
+
+    patch = json_object ();
+
+    json_object_foreach (to, key, value) {
+        json_t *old;
+
+        old = json_object_get (from, key);
+        if (!old)
+            json_object_set (patch, key, value);
+        else if (json_is_object (old) && json_is_object (value)) {
+            json_t *child;
+
+            child = qmicli_json_merge_diff (old, value);
+            if (json_object_size (child))
+                json_object_set_new (patch, key, child);
+            else
+                json_decref (child);
+        } else if (!json_equal (old, value))
+            json_object_set (patch, key, value);
+    }
+
+    json_object_foreach (from, key, value) {
+        if (!json_object_get (to, key))
+            json_object_set_new (patch, key, json_null ());
+    }
+
+    return patch;
+}
+
+void
+qmicli_output_set_monitor_keyframe (guint every)
+{
+    monitor_keyframe = every;
+}
+
+/* Lines of each 'stream' are either keyframes, holding the full document, or
+ * merge patches against the previous line, telling so in "keyframe". Keys
+ * in 'keep' are printed even if unchanged, so that interleaved streams can
+ * be told apart. Main thread only. */
+void
+qmicli_output_json_monitor (const gchar *stream,
+                            const gchar *const *keep,
+                            json_t *document,
+                            size_t flags)
+{
+    MonitorStream *state;
+    json_t *previous = NULL;
+    json_t *line;
+    guint i;
+
+    if (!monitor_keyframe || !document) {
+        qmicli_output_json_full (document, flags);
+        qmicli_arena_check ("a monitor line");
+        return;
+    }
+
+    if (!monitor_streams)
+        monitor_streams = g_hash_table_new_full (g_str_hash,
+                                                 g_str_equal,
+                                                 g_free,
+                                                 (GDestroyNotify)monitor_stream_free);
+
+    state = g_hash_table_lookup (monitor_streams, stream);
+    if (!state) {
+        state = g_slice_new0 (MonitorStream);
+        state->previous = g_string_new (NULL);
+        g_hash_table_insert (monitor_streams, g_strdup (stream), state);
+    }
+
+    if (state->samples % monitor_keyframe)
+        previous = json_loads (state->previous->str, 0, NULL);
+
+    g_string_truncate (state->previous, 0);
+    json_dump_callback (document, dump_callback, state->previous, JSON_COMPACT);
+    state->samples++;
+
+    if (!previous) {
+        line = document;
+        json_object_set_new (line, "keyframe", json_true ());
+    } else {
+        line = qmicli_json_merge_diff (previous, document);
+        for (i = 0; keep && keep[i]; i++) {
+            json_t *value;
+
+            value = json_object_get (document, keep[i]);
+            if (value)
+                json_object_set (line, keep[i], value);
+        }
+        json_object_set_new (line, "keyframe", json_false ());
+        json_decref (previous);
+        json_decref (document);
+    }
+
+    qmicli_output_json_full (line, flags);
+    qmicli_arena_check ("a monitor line");
+}
+
+void
+qmicli_output_shutdown (void)
+{
+    if (monitor_streams) {
+        g_hash_table_destroy (monitor_streams);
+        monitor_streams = NULL;
+    }
+
+    G_LOCK (output);
+    if (buffer) {
+        g_string_free (buffer, TRUE);
+        buffer = NULL;
+    }
+    G_UNLOCK (output);
+}
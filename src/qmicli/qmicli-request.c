@@ -0,0 +1,134 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * qmicli -- Command line interface to control QMI devices
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <libqmi-glib.h>
+
+#include "qmicli.h"
+
+/* Each request gets a cancellable of its own, cancelled along with its
+ * parent or once its deadline passes, so that cancelling or timing out one
+ * request leaves every other one untouched */
+struct _QmicliRequest {
+    GCancellable *cancellable;
+    GCancellable *parent;
+    gulong parent_cancelled_id;
+    gint64 deadline;
+    guint deadline_id;
+    gboolean expired;
+};
+
+static void
+parent_cancelled (GCancellable *parent,
+                  GCancellable *cancellable)
+{
+    g_cancellable_cancel (cancellable);
+}
+
+static gboolean
+deadline_expired (QmicliRequest *request)
+{
+    request->deadline_id = 0;
+    request->expired = TRUE;
+    g_debug ("Request deadline expired, cancelling");
+    g_cancellable_cancel (request->cancellable);
+    return FALSE;
+}
+
+QmicliRequest *
+qmicli_request_new (GCancellable *parent,
+                    gint64 deadline)
+{
+    QmicliRequest *request;
+
+    request = g_slice_new0 (QmicliRequest);
+    request->cancellable = g_cancellable_new ();
+    request->deadline = deadline;
+
+    if (parent) {
+        request->parent = g_object_ref (parent);
+        request->parent_cancelled_id = g_cancellable_connect (parent,
+                                                              G_CALLBACK (parent_cancelled),
+                                                              request->cancellable,
+                                                              NULL);
+    }
+
+    if (deadline) {
+        gint64 remaining;
+
+        remaining = deadline - g_get_monotonic_time ();
+        if (remaining <= 0) {
+            request->expired = TRUE;
+            g_cancellable_cancel (request->cancellable);
+        } else
+            request->deadline_id = g_timeout_add ((guint)(remaining / 1000),
+                                                  (GSourceFunc)deadline_expired,
+                                                  request);
+    }
+
+    return request;
+}
+
+void
+qmicli_request_free (QmicliRequest *request)
+{
+    if (!request)
+        return;
+
+    if (request->deadline_id)
+        g_source_remove (request->deadline_id);
+    if (request->parent) {
+        g_cancellable_disconnect (request->parent, request->parent_cancelled_id);
+        g_object_unref (request->parent);
+    }
+    g_object_unref (request->cancellable);
+    g_slice_free (QmicliRequest, request);
+}
+
+GCancellable *
+qmicli_request_get_cancellable (QmicliRequest *request)
+{
+    return request->cancellable;
+}
+
+/* Whether the request was cancelled because its deadline passed */
+gboolean
+qmicli_request_expired (QmicliRequest *request)
+{
+    return request->expired;
+}
+
+/* The per-call timeout, in seconds, never runs past the request deadline */
+guint
+qmicli_request_timeout (QmicliRequest *request,
+                        guint timeout)
+{
+    gint64 remaining;
+
+    if (!request || !request->deadline)
+        return timeout;
+
+    remaining = request->deadline - g_get_monotonic_time ();
+    if (remaining <= 0)
+        return 1;
+    return (guint) MIN ((gint64)timeout, (remaining + G_USEC_PER_SEC - 1) / G_USEC_PER_SEC);
+}
@@ -0,0 +1,556 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * qmicli -- Command line interface to control QMI devices
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <libqmi-glib.h>
+
+#include "qmicli.h"
+
+/* Sample log
+ *
+ * A directory of fixed-size segment files, each mmap()ed while written. A
+ * segment starts with a page-sized header, followed by blocks of fixed-size
+ * records; each block tells how many of its records are valid, the range of
+ * their timestamps, and the CRC-32 of those records. Writers carry on in the
+ * newest segment if it has room and its header matches their columns, and
+ * otherwise start a new one, dropping the oldest ones beyond the given
+ * count. Everything is in the byte order of the writer, which the header
+ * tells. */
+
+#define SAMPLE_LOG_MAGIC             "QMISLOG"
+#define SAMPLE_LOG_BYTE_ORDER        0x01020304
+#define SAMPLE_LOG_HEADER_SIZE       4096
+#define SAMPLE_LOG_COLUMN_NAME_SIZE  16
+#define SAMPLE_LOG_RECORDS_PER_BLOCK 256
+#define SAMPLE_LOG_BLOCKS            64
+#define SAMPLE_LOG_SEGMENT_PREFIX    "samples-"
+#define SAMPLE_LOG_SEGMENT_SUFFIX    ".qsl"
+
+typedef struct {
+    gchar magic[8];
+    guint32 byte_order;
+    guint32 schema_version;
+    guint32 n_columns;
+    guint32 records_per_block;
+    guint32 blocks;
+    guint32 reserved;
+    gint64 created;
+    gchar columns[QMICLI_SAMPLE_LOG_MAX_COLUMNS][SAMPLE_LOG_COLUMN_NAME_SIZE];
+} SampleLogHeader;
+
+G_STATIC_ASSERT (sizeof (SampleLogHeader) <= SAMPLE_LOG_HEADER_SIZE);
+
+typedef struct {
+    guint32 n_records;
+    guint32 crc;
+    gint64 first;
+    gint64 last;
+} SampleLogBlock;
+
+struct _QmicliSampleLog {
+    gchar *dir;
+    guint max_segments;
+    guint n_columns;
+    gchar **columns;
+    /* Current segment */
+    guint sequence;
+    guint8 *map;
+    gsize map_size;
+    guint block;
+};
+
+static guint32 crc32_table[256];
+
+static guint32
+crc32_update (guint32 crc,
+              const guint8 *data,
+              gsize length)
+{
+    gsize i;
+
+    if (G_UNLIKELY (!crc32_table[1])) {
+        guint32 n, c, k;
+
+        for (n = 0; n < 256; n++) {
+            c = n;
+            for (k = 0; k < 8; k++)
+                c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+            crc32_table[n] = c;
+        }
+    }
+
+    crc = ~crc;
+    for (i = 0; i < length; i++)
+        crc = crc32_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static gsize
+sample_log_record_size (guint n_columns)
+{
+    return (sizeof (gint64) + n_columns * sizeof (gint16) + 7) & ~(gsize)7;
+}
+
+static gsize
+sample_log_block_size (guint n_columns,
+                       guint records_per_block)
+{
+    return sizeof (SampleLogBlock) + records_per_block * sample_log_record_size (n_columns);
+}
+
+static gint
+uint_compare (const guint *a,
+              const guint *b)
+{
+    return (*a > *b) - (*a < *b);
+}
+
+/* Sequence numbers of the segments in 'dir', in ascending order */
+static GArray *
+sample_log_list_segments (const gchar *dir,
+                          GError **error)
+{
+    GArray *sequences;
+    const gchar *name;
+    GDir *gdir;
+
+    gdir = g_dir_open (dir, 0, error);
+    if (!gdir)
+        return NULL;
+
+    sequences = g_array_new (FALSE, FALSE, sizeof (guint));
+    while ((name = g_dir_read_name (gdir))) {
+        gchar *end;
+        guint64 number;
+        guint sequence;
+
+        if (!g_str_has_prefix (name, SAMPLE_LOG_SEGMENT_PREFIX))
+            continue;
+        number = g_ascii_strtoull (name + strlen (SAMPLE_LOG_SEGMENT_PREFIX), &end, 10);
+        if (end == name + strlen (SAMPLE_LOG_SEGMENT_PREFIX) ||
+            !g_str_equal (end, SAMPLE_LOG_SEGMENT_SUFFIX) ||
+            number > G_MAXUINT)
+            continue;
+        sequence = (guint)number;
+        g_array_append_val (sequences, sequence);
+    }
+    g_dir_close (gdir);
+
+    g_array_sort (sequences, (GCompareFunc)uint_compare);
+    return sequences;
+}
+
+static gchar *
+sample_log_segment_path (const gchar *dir,
+                         guint sequence)
+{
+    gchar *name;
+    gchar *path;
+
+    name = g_strdup_printf (SAMPLE_LOG_SEGMENT_PREFIX "%08u" SAMPLE_LOG_SEGMENT_SUFFIX, sequence);
+    path = g_build_filename (dir, name, NULL);
+    g_free (name);
+    return path;
+}
+
+static void
+sample_log_unmap (QmicliSampleLog *log)
+{
+    if (!log->map)
+        return;
+
+    msync (log->map, log->map_size, MS_SYNC);
+    munmap (log->map, log->map_size);
+    log->map = NULL;
+}
+
+/* Starts the next segment, dropping the oldest ones to stay within bounds */
+static gboolean
+sample_log_new_segment (QmicliSampleLog *log,
+                        GError **error)
+{
+    SampleLogHeader *header;
+    GArray *sequences;
+    gchar *path;
+    guint i;
+    gint fd;
+
+    sample_log_unmap (log);
+
+    sequences = sample_log_list_segments (log->dir, error);
+    if (!sequences)
+        return FALSE;
+    if (sequences->len)
+        log->sequence = g_array_index (sequences, guint, sequences->len - 1) + 1;
+    for (i = 0; i + log->max_segments <= sequences->len; i++) {
+        path = sample_log_segment_path (log->dir, g_array_index (sequences, guint, i));
+        g_unlink (path);
+        g_free (path);
+    }
+    g_array_unref (sequences);
+
+    path = sample_log_segment_path (log->dir, log->sequence);
+    log->map_size = SAMPLE_LOG_HEADER_SIZE +
+                    SAMPLE_LOG_BLOCKS * sample_log_block_size (log->n_columns, SAMPLE_LOG_RECORDS_PER_BLOCK);
+
+    fd = g_open (path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate (fd, log->map_size) < 0) {
+        g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+                     "couldn't create sample log segment '%s': %s",
+                     path, g_strerror (errno));
+        if (fd >= 0)
+            close (fd);
+        g_free (path);
+        return FALSE;
+    }
+
+    log->map = mmap (NULL, log->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close (fd);
+    if (log->map == MAP_FAILED) {
+        g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+                     "couldn't map sample log segment '%s': %s",
+                     path, g_strerror (errno));
+        log->map = NULL;
+        g_free (path);
+        return FALSE;
+    }
+    g_free (path);
+
+    /* The file is all zeros, i.e. every block empty */
+    header = (SampleLogHeader *)log->map;
+    memcpy (header->magic, SAMPLE_LOG_MAGIC, sizeof (SAMPLE_LOG_MAGIC));
+    header->byte_order = SAMPLE_LOG_BYTE_ORDER;
+    header->schema_version = QMICLI_SAMPLE_LOG_SCHEMA_VERSION;
+    header->n_columns = log->n_columns;
+    header->records_per_block = SAMPLE_LOG_RECORDS_PER_BLOCK;
+    header->blocks = SAMPLE_LOG_BLOCKS;
+    header->created = g_get_real_time ();
+    for (i = 0; i < log->n_columns; i++)
+        strncpy (header->columns[i], log->columns[i], SAMPLE_LOG_COLUMN_NAME_SIZE - 1);
+
+    log->block = 0;
+    return TRUE;
+}
+
+static gboolean
+sample_log_header_matches (QmicliSampleLog *log,
+                           const SampleLogHeader *header)
+{
+    guint i;
+
+    if (memcmp (header->magic, SAMPLE_LOG_MAGIC, sizeof (SAMPLE_LOG_MAGIC)) != 0 ||
+        header->byte_order != SAMPLE_LOG_BYTE_ORDER ||
+        header->schema_version != QMICLI_SAMPLE_LOG_SCHEMA_VERSION ||
+        header->n_columns != log->n_columns ||
+        header->records_per_block != SAMPLE_LOG_RECORDS_PER_BLOCK ||
+        header->blocks != SAMPLE_LOG_BLOCKS)
+        return FALSE;
+
+    for (i = 0; i < log->n_columns; i++) {
+        if (strncmp (header->columns[i], log->columns[i], SAMPLE_LOG_COLUMN_NAME_SIZE - 1) != 0)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/* Carries on after the last filled block of an existing segment, if it was
+ * written with the same columns and still has room. A block failing its
+ * CRC, e.g. after a crash, is left as is and the next one is used. */
+static gboolean
+sample_log_reopen_segment (QmicliSampleLog *log,
+                           guint sequence)
+{
+    const SampleLogBlock *block;
+    struct stat st;
+    gsize block_size;
+    gsize map_size;
+    guint8 *map;
+    gchar *path;
+    guint b;
+    gint fd;
+
+    block_size = sample_log_block_size (log->n_columns, SAMPLE_LOG_RECORDS_PER_BLOCK);
+    map_size = SAMPLE_LOG_HEADER_SIZE + SAMPLE_LOG_BLOCKS * block_size;
+
+    path = sample_log_segment_path (log->dir, sequence);
+    fd = g_open (path, O_RDWR, 0);
+    if (fd < 0 || fstat (fd, &st) < 0 || (gsize)st.st_size != map_size) {
+        g_debug ("Not reusing sample log segment '%s': unreadable, or of another size", path);
+        if (fd >= 0)
+            close (fd);
+        g_free (path);
+        return FALSE;
+    }
+
+    map = mmap (NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close (fd);
+    if (map == MAP_FAILED) {
+        g_debug ("Not reusing sample log segment '%s': couldn't map it", path);
+        g_free (path);
+        return FALSE;
+    }
+
+    if (!sample_log_header_matches (log, (const SampleLogHeader *)map)) {
+        g_debug ("Not reusing sample log segment '%s': another schema or columns", path);
+        munmap (map, map_size);
+        g_free (path);
+        return FALSE;
+    }
+
+    for (b = 0; b < SAMPLE_LOG_BLOCKS; b++) {
+        block = (const SampleLogBlock *)(map + SAMPLE_LOG_HEADER_SIZE + b * block_size);
+        if (block->n_records > SAMPLE_LOG_RECORDS_PER_BLOCK)
+            break;
+        if (block->n_records == SAMPLE_LOG_RECORDS_PER_BLOCK)
+            continue;
+        if (crc32_update (0, (const guint8 *)(block + 1),
+                          block->n_records * sample_log_record_size (log->n_columns)) == block->crc)
+            break;
+    }
+    if (b == SAMPLE_LOG_BLOCKS || block->n_records > SAMPLE_LOG_RECORDS_PER_BLOCK) {
+        g_debug ("Not reusing sample log segment '%s': full or damaged", path);
+        munmap (map, map_size);
+        g_free (path);
+        return FALSE;
+    }
+
+    g_debug ("Carrying on in sample log segment '%s' at block %u", path, b);
+    g_free (path);
+    log->sequence = sequence;
+    log->map = map;
+    log->map_size = map_size;
+    log->block = b;
+    return TRUE;
+}
+
+/* 'columns' is NULL-terminated; 'max_segments' bounds the disk usage */
+QmicliSampleLog *
+qmicli_sample_log_open (const gchar *dir,
+                        const gchar *const *columns,
+                        guint max_segments,
+                        GError **error)
+{
+    QmicliSampleLog *log;
+    GArray *sequences;
+    gboolean reopened;
+
+    g_return_val_if_fail (max_segments > 0, NULL);
+    g_return_val_if_fail (g_strv_length ((gchar **)columns) <= QMICLI_SAMPLE_LOG_MAX_COLUMNS, NULL);
+
+    if (g_mkdir_with_parents (dir, 0755) < 0) {
+        g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+                     "couldn't create sample log directory '%s': %s",
+                     dir, g_strerror (errno));
+        return NULL;
+    }
+
+    log = g_slice_new0 (QmicliSampleLog);
+    log->dir = g_strdup (dir);
+    log->max_segments = max_segments;
+    log->columns = g_strdupv ((gchar **)columns);
+    log->n_columns = g_strv_length (log->columns);
+
+    sequences = sample_log_list_segments (dir, error);
+    if (!sequences) {
+        qmicli_sample_log_close (log);
+        return NULL;
+    }
+    reopened = (sequences->len &&
+                sample_log_reopen_segment (log, g_array_index (sequences, guint, sequences->len - 1)));
+    g_array_unref (sequences);
+
+    if (!reopened && !sample_log_new_segment (log, error)) {
+        qmicli_sample_log_close (log);
+        return NULL;
+    }
+    return log;
+}
+
+void
+qmicli_sample_log_close (QmicliSampleLog *log)
+{
+    if (!log)
+        return;
+
+    sample_log_unmap (log);
+    g_strfreev (log->columns);
+    g_free (log->dir);
+    g_slice_free (QmicliSampleLog, log);
+}
+
+gboolean
+qmicli_sample_log_append (QmicliSampleLog *log,
+                          gint64 timestamp,
+                          const gint16 *values,
+                          GError **error)
+{
+    SampleLogBlock *block;
+    gsize record_size;
+    guint8 *record;
+
+    record_size = sample_log_record_size (log->n_columns);
+    block = (SampleLogBlock *)(log->map + SAMPLE_LOG_HEADER_SIZE +
+                               log->block * sample_log_block_size (log->n_columns, SAMPLE_LOG_RECORDS_PER_BLOCK));
+
+    if (block->n_records == SAMPLE_LOG_RECORDS_PER_BLOCK) {
+        if (++log->block == SAMPLE_LOG_BLOCKS) {
+            if (!sample_log_new_segment (log, error))
+                return FALSE;
+        }
+        return qmicli_sample_log_append (log, timestamp, values, error);
+    }
+
+    /* Record first, then the block header saying it's there */
+    record = (guint8 *)(block + 1) + block->n_records * record_size;
+    memcpy (record, &timestamp, sizeof (gint64));
+    memcpy (record + sizeof (gint64), values, log->n_columns * sizeof (gint16));
+
+    if (!block->n_records)
+        block->first = timestamp;
+    block->last = timestamp;
+    block->crc = crc32_update (block->crc, record, record_size);
+    block->n_records++;
+    return TRUE;
+}
+
+/* Calls 'func' for every record in [from, to] across all segments, oldest
+ * first. Blocks failing their CRC are skipped, and counted in
+ * 'out_corrupt' if given. */
+gboolean
+qmicli_sample_log_read (const gchar *dir,
+                        gint64 from,
+                        gint64 to,
+                        QmicliSampleLogFunc func,
+                        gpointer user_data,
+                        guint *out_corrupt,
+                        GError **error)
+{
+    GArray *sequences;
+    guint corrupt = 0;
+    guint i;
+
+    sequences = sample_log_list_segments (dir, error);
+    if (!sequences)
+        return FALSE;
+
+    for (i = 0; i < sequences->len; i++) {
+        const SampleLogHeader *header;
+        const gchar *columns[QMICLI_SAMPLE_LOG_MAX_COLUMNS + 1];
+        gchar names[QMICLI_SAMPLE_LOG_MAX_COLUMNS][SAMPLE_LOG_COLUMN_NAME_SIZE];
+        gint16 values[QMICLI_SAMPLE_LOG_MAX_COLUMNS];
+        gsize record_size;
+        gsize block_size;
+        struct stat st;
+        guint8 *map;
+        gchar *path;
+        guint b, r, c;
+        gint fd;
+
+        path = sample_log_segment_path (dir, g_array_index (sequences, guint, i));
+        fd = g_open (path, O_RDONLY, 0);
+        if (fd < 0 || fstat (fd, &st) < 0 || st.st_size < SAMPLE_LOG_HEADER_SIZE) {
+            g_debug ("Skipping unreadable sample log segment '%s'", path);
+            if (fd >= 0)
+                close (fd);
+            g_free (path);
+            continue;
+        }
+
+        map = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close (fd);
+        if (map == MAP_FAILED) {
+            g_debug ("Couldn't map sample log segment '%s'", path);
+            g_free (path);
+            continue;
+        }
+
+        header = (const SampleLogHeader *)map;
+        if (memcmp (header->magic, SAMPLE_LOG_MAGIC, sizeof (SAMPLE_LOG_MAGIC)) != 0 ||
+            header->byte_order != SAMPLE_LOG_BYTE_ORDER ||
+            header->schema_version != QMICLI_SAMPLE_LOG_SCHEMA_VERSION ||
+            header->n_columns > QMICLI_SAMPLE_LOG_MAX_COLUMNS ||
+            !header->records_per_block ||
+            (gsize)st.st_size < SAMPLE_LOG_HEADER_SIZE +
+                                (gsize)header->blocks * sample_log_block_size (header->n_columns,
+                                                                               header->records_per_block)) {
+            g_debug ("Skipping sample log segment '%s' with unsupported header", path);
+            munmap (map, st.st_size);
+            g_free (path);
+            continue;
+        }
+
+        for (c = 0; c < header->n_columns; c++) {
+            memcpy (names[c], header->columns[c], SAMPLE_LOG_COLUMN_NAME_SIZE);
+            names[c][SAMPLE_LOG_COLUMN_NAME_SIZE - 1] = '\0';
+            columns[c] = names[c];
+        }
+        columns[c] = NULL;
+
+        record_size = sample_log_record_size (header->n_columns);
+        block_size = sample_log_block_size (header->n_columns, header->records_per_block);
+
+        for (b = 0; b < header->blocks; b++) {
+            const SampleLogBlock *block;
+            const guint8 *records;
+
+            block = (const SampleLogBlock *)(map + SAMPLE_LOG_HEADER_SIZE + b * block_size);
+            /* The rest of the segment was never written */
+            if (!block->n_records)
+                break;
+            if (block->last < from || block->first > to)
+                continue;
+
+            records = (const guint8 *)(block + 1);
+            if (block->n_records > header->records_per_block ||
+                crc32_update (0, records, block->n_records * record_size) != block->crc) {
+                corrupt++;
+                continue;
+            }
+
+            for (r = 0; r < block->n_records; r++) {
+                const guint8 *record = records + r * record_size;
+                gint64 timestamp;
+
+                memcpy (&timestamp, record, sizeof (gint64));
+                if (timestamp < from || timestamp > to)
+                    continue;
+                memcpy (values, record + sizeof (gint64), header->n_columns * sizeof (gint16));
+                func (columns, timestamp, values, user_data);
+            }
+        }
+
+        munmap (map, st.st_size);
+        g_free (path);
+    }
+
+    g_array_unref (sequences);
+    if (out_corrupt)
+        *out_corrupt = corrupt;
+    return TRUE;
+}
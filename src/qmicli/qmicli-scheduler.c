@@ -0,0 +1,181 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * qmicli -- Command line interface to control QMI devices
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <libqmi-glib.h>
+
+#include "qmicli.h"
+
+/* Requests to each service go through a queue of their own. At most
+ * 'limit' are in flight per service; interactive requests go before
+ * periodic ones, which go before bulk ones, and bulk requests never take
+ * the last free slot so that a long scan can't starve a quick status
+ * query. Within a class, owners are served round-robin. */
+
+#define DEFAULT_IN_FLIGHT_LIMIT 2
+
+typedef struct {
+    gchar *owner;
+    GQueue jobs;
+} OwnerQueue;
+
+typedef struct {
+    guint limit;
+    guint in_flight;
+    /* OwnerQueues with pending jobs, per priority class */
+    GQueue owners[QMICLI_PRIORITY_LAST];
+} ServiceQueue;
+
+struct _QmicliJob {
+    ServiceQueue *queue;
+    QmicliPriority priority;
+    QmicliJobFunc func;
+    gpointer user_data;
+};
+
+static GHashTable *services;
+
+static ServiceQueue *
+service_queue_get (QmiService service)
+{
+    ServiceQueue *queue;
+
+    if (!services)
+        services = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+    queue = g_hash_table_lookup (services, GUINT_TO_POINTER (service));
+    if (!queue) {
+        queue = g_slice_new0 (ServiceQueue);
+        queue->limit = DEFAULT_IN_FLIGHT_LIMIT;
+        g_hash_table_insert (services, GUINT_TO_POINTER (service), queue);
+    }
+    return queue;
+}
+
+static void
+owner_queue_free (OwnerQueue *owner)
+{
+    g_free (owner->owner);
+    g_slice_free (OwnerQueue, owner);
+}
+
+static QmicliJob *
+next_job (ServiceQueue *queue)
+{
+    guint priority;
+
+    for (priority = 0; priority < QMICLI_PRIORITY_LAST; priority++) {
+        OwnerQueue *owner;
+        QmicliJob *job;
+
+        if (priority == QMICLI_PRIORITY_BULK &&
+            queue->limit > 1 &&
+            queue->in_flight + 1 >= queue->limit)
+            return NULL;
+
+        owner = g_queue_pop_head (&queue->owners[priority]);
+        if (!owner)
+            continue;
+
+        job = g_queue_pop_head (&owner->jobs);
+        if (g_queue_is_empty (&owner->jobs))
+            owner_queue_free (owner);
+        else
+            g_queue_push_tail (&queue->owners[priority], owner);
+        return job;
+    }
+    return NULL;
+}
+
+static void
+dispatch (ServiceQueue *queue)
+{
+    QmicliJob *job;
+
+    while (queue->in_flight < queue->limit && (job = next_job (queue)) != NULL) {
+        queue->in_flight++;
+        job->func (job, job->user_data);
+    }
+}
+
+void
+qmicli_scheduler_set_limit (QmiService service,
+                            guint limit)
+{
+    ServiceQueue *queue;
+
+    queue = service_queue_get (service);
+    queue->limit = MAX (limit, 1);
+    dispatch (queue);
+}
+
+/* The job runs from here already when there is a free slot */
+void
+qmicli_scheduler_submit (QmiService service,
+                         QmicliPriority priority,
+                         const gchar *owner,
+                         QmicliJobFunc func,
+                         gpointer user_data)
+{
+    ServiceQueue *queue;
+    OwnerQueue *owner_queue = NULL;
+    QmicliJob *job;
+    GList *l;
+
+    g_return_if_fail (priority < QMICLI_PRIORITY_LAST);
+
+    queue = service_queue_get (service);
+
+    job = g_slice_new0 (QmicliJob);
+    job->queue = queue;
+    job->priority = priority;
+    job->func = func;
+    job->user_data = user_data;
+
+    for (l = queue->owners[priority].head; l; l = g_list_next (l)) {
+        if (g_str_equal (((OwnerQueue *)l->data)->owner, owner)) {
+            owner_queue = l->data;
+            break;
+        }
+    }
+    if (!owner_queue) {
+        owner_queue = g_slice_new0 (OwnerQueue);
+        owner_queue->owner = g_strdup (owner);
+        g_queue_push_tail (&queue->owners[priority], owner_queue);
+    }
+    g_queue_push_tail (&owner_queue->jobs, job);
+
+    dispatch (queue);
+}
+
+void
+qmicli_scheduler_done (QmicliJob *job)
+{
+    ServiceQueue *queue;
+
+    queue = job->queue;
+    g_assert (queue->in_flight > 0);
+    queue->in_flight--;
+    g_slice_free (QmicliJob, job);
+
+    dispatch (queue);
+}
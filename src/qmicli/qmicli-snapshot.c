@@ -0,0 +1,340 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * qmicli -- Command line interface to control QMI devices
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <libqmi-glib.h>
+
+#include "qmicli.h"
+#include "qmicli-json-generated.h"
+
+/* Options */
+static gboolean status_snapshot_flag;
+
+static GOptionEntry entries[] = {
+    { "status-snapshot", 0, 0, G_OPTION_ARG_NONE, &status_snapshot_flag,
+      "Get device IDs, revision, serving system, signal info, packet service status and card status in one go",
+      NULL
+    },
+    { NULL }
+};
+
+GOptionGroup *
+qmicli_snapshot_get_option_group (void)
+{
+        GOptionGroup *group;
+
+        group = g_option_group_new ("snapshot",
+                                    "Status snapshot options",
+                                    "Show status snapshot options",
+                                    NULL,
+                                    NULL);
+        g_option_group_add_entries (group, entries);
+
+        return group;
+}
+
+gboolean
+qmicli_snapshot_options_enabled (void)
+{
+    return status_snapshot_flag;
+}
+
+/*****************************************************************************/
+/* Reads making up the snapshot */
+
+typedef void (* SerializeFunc) (gpointer output,
+                                json_t *json);
+
+typedef struct {
+    const gchar *section;
+    QmiService service;
+    QmicliCoalescedMessage message;
+    SerializeFunc serialize;
+} SnapshotRead;
+
+/* Same freshness windows as the single actions */
+static const SnapshotRead reads[] = {
+    { "ids",                   QMI_SERVICE_DMS,
+      QMICLI_COALESCED_MESSAGE (dms, get_ids, 0),
+      (SerializeFunc) qmicli_json_dms_get_ids_output },
+    { "revision",              QMI_SERVICE_DMS,
+      QMICLI_COALESCED_MESSAGE (dms, get_revision, 0),
+      (SerializeFunc) qmicli_json_dms_get_revision_output },
+    { "serving system",        QMI_SERVICE_NAS,
+      QMICLI_COALESCED_MESSAGE (nas, get_serving_system, 5000),
+      (SerializeFunc) qmicli_json_nas_get_serving_system_output },
+    { "signal info",           QMI_SERVICE_NAS,
+      QMICLI_COALESCED_MESSAGE (nas, get_signal_info, 1000),
+      (SerializeFunc) qmicli_json_nas_get_signal_info_output },
+    { "packet service status", QMI_SERVICE_WDS,
+      QMICLI_COALESCED_MESSAGE (wds, get_packet_service_status, 1000),
+      (SerializeFunc) qmicli_json_wds_get_packet_service_status_output },
+    { "card status",           QMI_SERVICE_UIM,
+      QMICLI_COALESCED_MESSAGE (uim, get_card_status, 0),
+      (SerializeFunc) qmicli_json_uim_get_card_status_output },
+};
+
+static const QmiService services[] = {
+    QMI_SERVICE_DMS,
+    QMI_SERVICE_NAS,
+    QMI_SERVICE_WDS,
+    QMI_SERVICE_UIM,
+};
+
+/* Context */
+typedef struct {
+    QmiDevice *device;
+    QmicliRequest *request;
+    GCancellable *cancellable;
+    QmiClient *clients[G_N_ELEMENTS (services)];
+    json_t *json_output;
+    gboolean operation_status;
+    /* Allocations and reads not finished yet */
+    guint pending;
+    /* Releases not finished yet */
+    guint releasing;
+} Context;
+static Context *ctx;
+
+typedef struct {
+    const SnapshotRead *read;
+    QmiClient *client;
+    QmicliJob *job;
+} PendingRead;
+
+static void
+context_free (Context *context)
+{
+    guint i;
+
+    if (!context)
+        return;
+
+    for (i = 0; i < G_N_ELEMENTS (services); i++) {
+        if (context->clients[i])
+            g_object_unref (context->clients[i]);
+    }
+    if (context->json_output)
+        json_decref (context->json_output);
+    g_object_unref (context->cancellable);
+    qmicli_request_free (context->request);
+    g_object_unref (context->device);
+    g_slice_free (Context, context);
+}
+
+static void
+release_client_ready (QmiDevice *device,
+                      GAsyncResult *res)
+{
+    gboolean operation_status;
+    GError *error = NULL;
+
+    if (!qmi_device_release_client_finish (device, res, &error)) {
+        g_debug ("couldn't release client: %s", error->message);
+        g_error_free (error);
+    }
+
+    if (--ctx->releasing)
+        return;
+
+    operation_status = ctx->operation_status;
+    context_free (ctx);
+    ctx = NULL;
+    qmicli_async_operation_done (operation_status);
+}
+
+static void
+snapshot_complete (void)
+{
+    guint i;
+
+    if (!ctx->operation_status)
+        json_object_set_new (ctx->json_output, "success", json_false ());
+    qmicli_output_json (ctx->json_output);
+    ctx->json_output = NULL;
+
+    /* Release every client we got, all at once */
+    for (i = 0; i < G_N_ELEMENTS (services); i++) {
+        if (ctx->clients[i])
+            ctx->releasing++;
+    }
+
+    if (!ctx->releasing) {
+        context_free (ctx);
+        ctx = NULL;
+        qmicli_async_operation_done (FALSE);
+        return;
+    }
+
+    for (i = 0; i < G_N_ELEMENTS (services); i++) {
+        if (!ctx->clients[i])
+            continue;
+        qmi_device_release_client (ctx->device,
+                                   ctx->clients[i],
+                                   QMI_DEVICE_RELEASE_CLIENT_FLAGS_RELEASE_CID,
+                                   10,
+                                   NULL,
+                                   (GAsyncReadyCallback)release_client_ready,
+                                   NULL);
+    }
+}
+
+static void
+pending_done (void)
+{
+    if (--ctx->pending == 0)
+        snapshot_complete ();
+}
+
+static void
+section_failed (const SnapshotRead *read,
+                const gchar *message)
+{
+    json_object_set_new (ctx->json_output,
+                         read->section,
+                         json_pack ("{ss}", "error", message));
+    ctx->operation_status = FALSE;
+}
+
+static void
+read_ready (GObject *client,
+            GAsyncResult *res,
+            PendingRead *pending)
+{
+    const SnapshotRead *read = pending->read;
+    gpointer output;
+    GError *error = NULL;
+
+    qmicli_scheduler_done (pending->job);
+
+    output = read->message.finish (client, res, &error);
+    if (output && read->message.get_result (output, &error)) {
+        json_t *section;
+
+        section = json_object ();
+        read->serialize (output, section);
+        qmicli_coalesce_json_add_age (section, res);
+        json_object_set_new (ctx->json_output, read->section, section);
+    } else
+        section_failed (read, error->message);
+
+    if (output)
+        read->message.output_unref (output);
+    if (error)
+        g_error_free (error);
+    g_object_unref (pending->client);
+    g_slice_free (PendingRead, pending);
+    pending_done ();
+}
+
+static void
+read_job (QmicliJob *job,
+          PendingRead *pending)
+{
+    pending->job = job;
+    qmicli_coalesce_call (&pending->read->message,
+                          G_OBJECT (pending->client),
+                          NULL,
+                          NULL,
+                          qmicli_request_timeout (ctx->request, 10),
+                          ctx->cancellable,
+                          (GAsyncReadyCallback)read_ready,
+                          pending);
+}
+
+static void
+allocate_client_ready (QmiDevice *device,
+                       GAsyncResult *res,
+                       gpointer service_index)
+{
+    QmiService service;
+    QmiClient *client;
+    GError *error = NULL;
+    guint i;
+
+    service = services[GPOINTER_TO_UINT (service_index)];
+
+    client = qmi_device_allocate_client_finish (device, res, &error);
+    if (!client) {
+        for (i = 0; i < G_N_ELEMENTS (reads); i++) {
+            if (reads[i].service == service)
+                section_failed (&reads[i], error->message);
+        }
+        g_error_free (error);
+        pending_done ();
+        return;
+    }
+    ctx->clients[GPOINTER_TO_UINT (service_index)] = client;
+
+    /* Reads from this service start right away, whatever the others do */
+    for (i = 0; i < G_N_ELEMENTS (reads); i++) {
+        PendingRead *pending;
+
+        if (reads[i].service != service)
+            continue;
+
+        pending = g_slice_new0 (PendingRead);
+        pending->read = &reads[i];
+        pending->client = g_object_ref (client);
+        ctx->pending++;
+        qmicli_scheduler_submit (service,
+                                 QMICLI_PRIORITY_INTERACTIVE,
+                                 "status-snapshot",
+                                 (QmicliJobFunc)read_job,
+                                 pending);
+    }
+
+    pending_done ();
+}
+
+void
+qmicli_snapshot_run (QmiDevice *device,
+                     GCancellable *cancellable)
+{
+    guint i;
+
+    /* Initialize context */
+    ctx = g_slice_new0 (Context);
+    ctx->device = g_object_ref (device);
+    ctx->request = qmicli_request_new (cancellable, qmicli_get_deadline ());
+    ctx->cancellable = g_object_ref (qmicli_request_get_cancellable (ctx->request));
+    ctx->operation_status = TRUE;
+    ctx->json_output = json_pack ("{sbss}",
+         "success", 1,
+         "device", qmi_device_get_path_display (device)
+          );
+
+    /* All clients are allocated at once */
+    ctx->pending = G_N_ELEMENTS (services);
+    for (i = 0; i < G_N_ELEMENTS (services); i++)
+        qmi_device_allocate_client (device,
+                                    services[i],
+                                    QMI_CID_NONE,
+                                    qmicli_request_timeout (ctx->request, 10),
+                                    ctx->cancellable,
+                                    (GAsyncReadyCallback)allocate_client_ready,
+                                    GUINT_TO_POINTER (i));
+}
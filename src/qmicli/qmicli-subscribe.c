@@ -0,0 +1,890 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * qmicli -- Command line interface to control QMI devices
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <libqmi-glib.h>
+
+#include "qmicli.h"
+#include "qmicli-helpers.h"
+#include "qmicli-json-generated.h"
+
+/* Context */
+typedef struct {
+    QmiDevice *device;
+    GCancellable *cancellable;
+    QmicliRequest *request;
+    gulong cancelled_id;
+    GArray *services;
+    GList *clients;
+    GList *releasing;
+    QmicliHistory *history;
+    guint history_timeout_id;
+    QmicliSampleLog *sample_log;
+} Context;
+static Context *ctx;
+
+/* Options */
+static gchar *subscribe_str;
+static gint history_secs;
+static gchar *sample_log_str;
+static gchar *sample_log_export_str;
+static gchar *sample_log_format_str;
+static gint64 sample_log_from_secs;
+static gint64 sample_log_to_secs;
+
+static GOptionEntry entries[] = {
+    { "subscribe", 0, 0, G_OPTION_ARG_STRING, &subscribe_str,
+      "Print the given indications as they arrive, one JSON object per line, until cancelled",
+      "[nas.serving-system,nas.signal-strength,wds.packet-status,uim.card-status]"
+    },
+    { "subscribe-history", 0, 0, G_OPTION_ARG_INT, &history_secs,
+      "Keep signal strength samples and print their min/max/avg over the last SECONDS, every SECONDS. Use with `--subscribe=nas.signal-strength'",
+      "[SECONDS]"
+    },
+    { "subscribe-log", 0, 0, G_OPTION_ARG_STRING, &sample_log_str,
+      "Also write signal strength samples to a binary log under DIR, keeping about a week of them. Use with `--subscribe=nas.signal-strength'",
+      "[DIR]"
+    },
+    { "subscribe-log-export", 0, 0, G_OPTION_ARG_STRING, &sample_log_export_str,
+      "Print the samples of the log under DIR, without using any device",
+      "[DIR]"
+    },
+    { "subscribe-log-format", 0, 0, G_OPTION_ARG_STRING, &sample_log_format_str,
+      "Format of the exported samples, `ndjson' by default. Use with `--subscribe-log-export'",
+      "[ndjson|csv]"
+    },
+    { "subscribe-log-from", 0, 0, G_OPTION_ARG_INT64, &sample_log_from_secs,
+      "Only export samples taken at or after this time, in seconds since the epoch. Use with `--subscribe-log-export'",
+      "[SECONDS]"
+    },
+    { "subscribe-log-to", 0, 0, G_OPTION_ARG_INT64, &sample_log_to_secs,
+      "Only export samples taken at or before this time, in seconds since the epoch. Use with `--subscribe-log-export'",
+      "[SECONDS]"
+    },
+    { NULL }
+};
+
+GOptionGroup *
+qmicli_subscribe_get_option_group (void)
+{
+        GOptionGroup *group;
+
+        group = g_option_group_new ("subscribe",
+                                    "Subscription options",
+                                    "Show indication subscription options",
+                                    NULL,
+                                    NULL);
+        g_option_group_add_entries (group, entries);
+
+        return group;
+}
+
+/*****************************************************************************/
+/* Event lines */
+
+static json_t *
+event_new (const gchar *event)
+{
+    json_t *json;
+
+    json = json_object ();
+    json_object_set_new_nocheck (json, "timestamp", json_real ((gdouble)g_get_real_time () / G_USEC_PER_SEC));
+    json_object_set_new_nocheck (json, "event", json_string (event));
+    json_object_set_new_nocheck (json, "device", json_string (qmi_device_get_path_display (ctx->device)));
+    return json;
+}
+
+static void
+event_print (json_t *json)
+{
+    /* Always one line per event, whatever --json says */
+    qmicli_output_json_full (json, JSON_PRESERVE_ORDER | JSON_COMPACT);
+    qmicli_arena_check ("an event line");
+}
+
+/* Indications, one monitor stream per event */
+static void
+sample_print (json_t *json)
+{
+    static const gchar *const keep[] = { "event", NULL };
+
+    qmicli_output_json_monitor (json_string_value (json_object_get (json, "event")),
+                                keep,
+                                json,
+                                JSON_PRESERVE_ORDER | JSON_COMPACT);
+}
+
+static void
+subscription_failed (const gchar *name,
+                     GError *error)
+{
+    qmicli_output_json (json_pack("{sbssssss}",
+         "success", 0,
+         "error", "couldn't subscribe",
+         "message", error->message,
+         "subscription", name
+          ));
+    fflush (stdout);
+}
+
+/*****************************************************************************/
+/* NAS */
+
+static void
+nas_serving_system_indication (QmiClientNas *client,
+                               QmiIndicationNasServingSystemOutput *output)
+{
+    json_t *json;
+
+    qmicli_coalesce_invalidate ("nas/get_serving_system/");
+    qmicli_coalesce_invalidate ("nas/get_home_network/");
+
+    json = event_new ("nas.serving-system");
+    qmicli_json_nas_serving_system_indication (output, json);
+    sample_print (json);
+}
+
+/* Signal strength history, constant in size; at one sample a second, an
+ * hour of it */
+#define HISTORY_CAPACITY 3600
+
+typedef enum {
+    HISTORY_COLUMN_RSSI,
+    HISTORY_COLUMN_RSRQ,
+    HISTORY_COLUMN_RSRP,
+    HISTORY_COLUMN_SNR,
+    HISTORY_COLUMN_LAST
+} HistoryColumn;
+
+/* NULL-terminated, as the sample log wants them */
+static const gchar *const history_column_names[] = {
+    "rssi", "rsrq", "rsrp", "snr", NULL
+};
+
+/* Sample log segments to keep; each holds 16384 samples, so at one sample a
+ * second this is about a week */
+#define SAMPLE_LOG_MAX_SEGMENTS 40
+
+static void
+signal_sample_values (QmiIndicationNasEventReportOutput *output,
+                      gint16 *values)
+{
+    QmiNasRadioInterface radio_interface;
+    gint8 strength;
+    gint8 rsrq;
+    gint16 rsrp;
+    gint16 snr;
+    guint i;
+
+    for (i = 0; i < HISTORY_COLUMN_LAST; i++)
+        values[i] = QMICLI_HISTORY_MISSING;
+
+    if (qmi_indication_nas_event_report_output_get_signal_strength (output, &strength, &radio_interface, NULL))
+        values[HISTORY_COLUMN_RSSI] = strength;
+    if (qmi_indication_nas_event_report_output_get_rsrq (output, &rsrq, &radio_interface, NULL))
+        values[HISTORY_COLUMN_RSRQ] = rsrq;
+    if (qmi_indication_nas_event_report_output_get_lte_rsrp (output, &rsrp, NULL))
+        values[HISTORY_COLUMN_RSRP] = rsrp;
+    /* In units of 0.1 dB */
+    if (qmi_indication_nas_event_report_output_get_lte_snr (output, &snr, NULL))
+        values[HISTORY_COLUMN_SNR] = snr;
+}
+
+static gboolean
+history_summary (void)
+{
+    QmicliHistoryAggregate aggregate;
+    json_t *json;
+    gint64 now;
+    guint first;
+    guint count;
+    guint i;
+
+    now = g_get_monotonic_time ();
+    count = qmicli_history_range (ctx->history,
+                                  now - (gint64)history_secs * G_USEC_PER_SEC,
+                                  now,
+                                  &first);
+
+    json = event_new ("nas.signal-history");
+    json_object_set_new_nocheck (json, "window", json_integer (history_secs));
+    json_object_set_new_nocheck (json, "samples", json_integer (count));
+    for (i = 0; i < HISTORY_COLUMN_LAST; i++) {
+        qmicli_history_aggregate (ctx->history, first, count, i, &aggregate);
+        if (!aggregate.count)
+            continue;
+        json_object_set_new_nocheck (json, history_column_names[i],
+                                     json_pack ("{sisisf}",
+                                                "min", aggregate.min,
+                                                "max", aggregate.max,
+                                                "avg", aggregate.avg));
+    }
+    event_print (json);
+    return TRUE;
+}
+
+static void
+nas_event_report_indication (QmiClientNas *client,
+                             QmiIndicationNasEventReportOutput *output)
+{
+    GError *error = NULL;
+    json_t *json;
+
+    qmicli_coalesce_invalidate ("nas/get_signal_info/");
+
+    if (ctx->history || ctx->sample_log) {
+        gint16 values[HISTORY_COLUMN_LAST];
+
+        signal_sample_values (output, values);
+        if (ctx->history)
+            qmicli_history_append (ctx->history, g_get_monotonic_time (), values);
+        if (ctx->sample_log &&
+            !qmicli_sample_log_append (ctx->sample_log, g_get_real_time (), values, &error)) {
+            g_warning ("couldn't log sample: %s", error->message);
+            g_error_free (error);
+            qmicli_sample_log_close (ctx->sample_log);
+            ctx->sample_log = NULL;
+        }
+    }
+
+    json = event_new ("nas.signal-strength");
+    qmicli_json_nas_event_report_indication (output, json);
+    sample_print (json);
+}
+
+static void
+nas_register_indications_ready (QmiClientNas *client,
+                                GAsyncResult *res,
+                                const gchar *name)
+{
+    QmiMessageNasRegisterIndicationsOutput *output;
+    GError *error = NULL;
+
+    output = qmi_client_nas_register_indications_finish (client, res, &error);
+    if (output) {
+        qmi_message_nas_register_indications_output_get_result (output, &error);
+        qmi_message_nas_register_indications_output_unref (output);
+    }
+
+    if (error) {
+        subscription_failed (name, error);
+        g_error_free (error);
+    }
+}
+
+static void
+nas_serving_system_enable (QmiClient *client,
+                           const gchar *name)
+{
+    QmiMessageNasRegisterIndicationsInput *input;
+
+    input = qmi_message_nas_register_indications_input_new ();
+    qmi_message_nas_register_indications_input_set_serving_system_events (input, TRUE, NULL);
+    qmi_client_nas_register_indications (QMI_CLIENT_NAS (client),
+                                         input,
+                                         qmicli_request_timeout (ctx->request, 10),
+                                         ctx->cancellable,
+                                         (GAsyncReadyCallback)nas_register_indications_ready,
+                                         (gpointer)name);
+    qmi_message_nas_register_indications_input_unref (input);
+}
+
+static void
+nas_set_event_report_ready (QmiClientNas *client,
+                            GAsyncResult *res,
+                            const gchar *name)
+{
+    QmiMessageNasSetEventReportOutput *output;
+    GError *error = NULL;
+
+    output = qmi_client_nas_set_event_report_finish (client, res, &error);
+    if (output) {
+        qmi_message_nas_set_event_report_output_get_result (output, &error);
+        qmi_message_nas_set_event_report_output_unref (output);
+    }
+
+    if (error) {
+        subscription_failed (name, error);
+        g_error_free (error);
+    }
+}
+
+static void
+nas_signal_strength_enable (QmiClient *client,
+                            const gchar *name)
+{
+    /* Report whenever the strength crosses one of these, in dBm */
+    static const gint8 thresholds[] = { -110, -100, -90, -80, -70, -60, -50 };
+    QmiMessageNasSetEventReportInput *input;
+    GArray *array;
+
+    array = g_array_sized_new (FALSE, FALSE, sizeof (gint8), G_N_ELEMENTS (thresholds));
+    g_array_append_vals (array, thresholds, G_N_ELEMENTS (thresholds));
+
+    input = qmi_message_nas_set_event_report_input_new ();
+    qmi_message_nas_set_event_report_input_set_signal_strength_indicator (input, TRUE, array, NULL);
+    if (history_secs || sample_log_str) {
+        /* So that the history and the log also get LTE samples; in units of 0.1 dB
+         * and 1 dB respectively */
+        qmi_message_nas_set_event_report_input_set_lte_snr_delta (input, TRUE, 10, NULL);
+        qmi_message_nas_set_event_report_input_set_lte_rsrp_delta (input, TRUE, 1, NULL);
+    }
+    qmi_client_nas_set_event_report (QMI_CLIENT_NAS (client),
+                                     input,
+                                     qmicli_request_timeout (ctx->request, 10),
+                                     ctx->cancellable,
+                                     (GAsyncReadyCallback)nas_set_event_report_ready,
+                                     (gpointer)name);
+    qmi_message_nas_set_event_report_input_unref (input);
+    g_array_unref (array);
+}
+
+/*****************************************************************************/
+/* WDS */
+
+static void
+wds_packet_service_status_indication (QmiClientWds *client,
+                                      QmiIndicationWdsPacketServiceStatusOutput *output)
+{
+    json_t *json;
+
+    qmicli_coalesce_invalidate ("wds/get_packet_service_status/");
+
+    json = event_new ("wds.packet-status");
+    qmicli_json_wds_packet_service_status_indication (output, json);
+    sample_print (json);
+}
+
+/*****************************************************************************/
+/* UIM */
+
+static void
+uim_card_status_indication (QmiClientUim *client,
+                            QmiIndicationUimCardStatusOutput *output)
+{
+    json_t *json;
+
+    json = event_new ("uim.card-status");
+    qmicli_json_uim_card_status_indication (output, json);
+    sample_print (json);
+}
+
+static void
+uim_register_events_ready (QmiClientUim *client,
+                           GAsyncResult *res,
+                           const gchar *name)
+{
+    QmiMessageUimRegisterEventsOutput *output;
+    GError *error = NULL;
+
+    output = qmi_client_uim_register_events_finish (client, res, &error);
+    if (output) {
+        qmi_message_uim_register_events_output_get_result (output, &error);
+        qmi_message_uim_register_events_output_unref (output);
+    }
+
+    if (error) {
+        subscription_failed (name, error);
+        g_error_free (error);
+    }
+}
+
+static void
+uim_card_status_enable (QmiClient *client,
+                        const gchar *name)
+{
+    QmiMessageUimRegisterEventsInput *input;
+
+    input = qmi_message_uim_register_events_input_new ();
+    qmi_message_uim_register_events_input_set_event_registration_mask (
+        input,
+        QMI_UIM_EVENT_REGISTRATION_FLAG_CARD_STATUS,
+        NULL);
+    qmi_client_uim_register_events (QMI_CLIENT_UIM (client),
+                                    input,
+                                    qmicli_request_timeout (ctx->request, 10),
+                                    ctx->cancellable,
+                                    (GAsyncReadyCallback)uim_register_events_ready,
+                                    (gpointer)name);
+    qmi_message_uim_register_events_input_unref (input);
+}
+
+/*****************************************************************************/
+/* Supported subscriptions */
+
+typedef struct {
+    const gchar *name;
+    QmiService service;
+    const gchar *signal;
+    GCallback indication;
+    /* Registration request, NULL if the indication is always sent */
+    void (* enable) (QmiClient *client,
+                     const gchar *name);
+} Subscription;
+
+static const Subscription subscriptions[] = {
+    { "nas.serving-system",  QMI_SERVICE_NAS, "serving-system",
+      G_CALLBACK (nas_serving_system_indication),        nas_serving_system_enable },
+    { "nas.signal-strength", QMI_SERVICE_NAS, "event-report",
+      G_CALLBACK (nas_event_report_indication),          nas_signal_strength_enable },
+    { "wds.packet-status",   QMI_SERVICE_WDS, "packet-service-status",
+      G_CALLBACK (wds_packet_service_status_indication), NULL },
+    { "uim.card-status",     QMI_SERVICE_UIM, "card-status",
+      G_CALLBACK (uim_card_status_indication),           uim_card_status_enable },
+};
+
+/* Bitmask of the selected entries in subscriptions[] */
+static guint selected;
+
+static gboolean
+subscription_selected (const gchar *name)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (subscriptions); i++) {
+        if (g_str_equal (subscriptions[i].name, name))
+            return !!(selected & (1 << i));
+    }
+    return FALSE;
+}
+
+gboolean
+qmicli_subscribe_options_enabled (void)
+{
+    static gboolean checked = FALSE;
+    gchar **items;
+    guint i, j;
+
+    if (checked)
+        return !!selected;
+
+    if (subscribe_str) {
+        items = g_strsplit (subscribe_str, ",", -1);
+        for (i = 0; items[i]; i++) {
+            const gchar *item;
+
+            item = g_strstrip (items[i]);
+            for (j = 0; j < G_N_ELEMENTS (subscriptions); j++) {
+                if (g_str_equal (item, subscriptions[j].name)) {
+                    selected |= (1 << j);
+                    break;
+                }
+            }
+
+            if (j == G_N_ELEMENTS (subscriptions)) {
+                qmicli_output_json (json_pack("{sbssss}",
+                     "success", 0,
+                     "error", "unknown subscription",
+                     "message", item
+                      ));
+                exit (EXIT_FAILURE);
+            }
+        }
+        g_strfreev (items);
+
+        if (!selected) {
+            qmicli_output_json (json_pack("{sbss}",
+                 "success", 0,
+                 "error", "no subscriptions given"
+                  ));
+            exit (EXIT_FAILURE);
+        }
+    }
+
+    if (history_secs < 0) {
+        qmicli_output_json (json_pack("{sbss}",
+             "success", 0,
+             "error", "--subscribe-history must not be negative"
+              ));
+        exit (EXIT_FAILURE);
+    } else if (history_secs > 0 && !subscription_selected ("nas.signal-strength")) {
+        qmicli_output_json (json_pack("{sbss}",
+             "success", 0,
+             "error", "--subscribe-history must be used with --subscribe=nas.signal-strength"
+              ));
+        exit (EXIT_FAILURE);
+    }
+
+    if (sample_log_str && !subscription_selected ("nas.signal-strength")) {
+        qmicli_output_json (json_pack("{sbss}",
+             "success", 0,
+             "error", "--subscribe-log must be used with --subscribe=nas.signal-strength"
+              ));
+        exit (EXIT_FAILURE);
+    }
+
+    if ((sample_log_format_str || sample_log_from_secs || sample_log_to_secs) &&
+        !sample_log_export_str) {
+        qmicli_output_json (json_pack("{sbss}",
+             "success", 0,
+             "error", "--subscribe-log-format, --subscribe-log-from and --subscribe-log-to must be used with --subscribe-log-export"
+              ));
+        exit (EXIT_FAILURE);
+    }
+
+    if (sample_log_format_str &&
+        !g_str_equal (sample_log_format_str, "ndjson") &&
+        !g_str_equal (sample_log_format_str, "csv")) {
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "unknown sample log format",
+             "message", sample_log_format_str
+              ));
+        exit (EXIT_FAILURE);
+    }
+
+    checked = TRUE;
+    return !!selected;
+}
+
+/*****************************************************************************/
+/* Running */
+
+static void
+context_free (Context *context)
+{
+    if (!context)
+        return;
+
+    if (context->cancelled_id)
+        g_cancellable_disconnect (context->cancellable, context->cancelled_id);
+    if (context->history_timeout_id)
+        g_source_remove (context->history_timeout_id);
+    qmicli_history_free (context->history);
+    qmicli_sample_log_close (context->sample_log);
+    g_list_free_full (context->clients, g_object_unref);
+    g_array_unref (context->services);
+    g_object_unref (context->cancellable);
+    qmicli_request_free (context->request);
+    g_object_unref (context->device);
+    g_slice_free (Context, context);
+}
+
+static void release_next_client (void);
+
+static void
+release_client_ready (QmiDevice *device,
+                      GAsyncResult *res)
+{
+    GError *error = NULL;
+
+    if (!qmi_device_release_client_finish (device, res, &error)) {
+        g_debug ("couldn't release client: %s", error->message);
+        g_error_free (error);
+    }
+
+    release_next_client ();
+}
+
+static void
+release_next_client (void)
+{
+    QmiClient *client;
+
+    if (!ctx->releasing) {
+        context_free (ctx);
+        ctx = NULL;
+        qmicli_async_operation_done (TRUE);
+        return;
+    }
+
+    client = QMI_CLIENT (ctx->releasing->data);
+    ctx->releasing = g_list_delete_link (ctx->releasing, ctx->releasing);
+    qmi_device_release_client (ctx->device,
+                               client,
+                               QMI_DEVICE_RELEASE_CLIENT_FLAGS_RELEASE_CID,
+                               10,
+                               NULL,
+                               (GAsyncReadyCallback)release_client_ready,
+                               NULL);
+}
+
+static gboolean
+unsubscribe (void)
+{
+    GList *l;
+    guint i;
+
+    /* Stop printing events, then release every client we allocated */
+    if (ctx->history_timeout_id) {
+        g_source_remove (ctx->history_timeout_id);
+        ctx->history_timeout_id = 0;
+    }
+    for (l = ctx->clients; l; l = g_list_next (l)) {
+        for (i = 0; i < G_N_ELEMENTS (subscriptions); i++)
+            g_signal_handlers_disconnect_by_func (l->data, subscriptions[i].indication, NULL);
+    }
+
+    ctx->releasing = g_list_copy (ctx->clients);
+    release_next_client ();
+    return FALSE;
+}
+
+static void
+subscriptions_cancelled (GCancellable *cancellable)
+{
+    /* Not from within the cancellation handler itself */
+    g_idle_add ((GSourceFunc)unsubscribe, NULL);
+}
+
+static void allocate_next_client (void);
+
+static void
+allocate_client_ready (QmiDevice *device,
+                       GAsyncResult *res)
+{
+    QmiClient *client;
+    QmiService service;
+    GError *error = NULL;
+    guint i;
+
+    client = qmi_device_allocate_client_finish (device, res, &error);
+    if (!client) {
+        qmicli_output_json (json_pack("{sbssssss}",
+             "success", 0,
+             "error", "couldn't create client for the service",
+             "message", error->message,
+             "service", qmi_service_get_string (g_array_index (ctx->services, QmiService, 0))
+              ));
+        g_error_free (error);
+        ctx->releasing = g_list_copy (ctx->clients);
+        release_next_client ();
+        return;
+    }
+
+    ctx->clients = g_list_append (ctx->clients, client);
+    service = g_array_index (ctx->services, QmiService, 0);
+    g_array_remove_index (ctx->services, 0);
+
+    for (i = 0; i < G_N_ELEMENTS (subscriptions); i++) {
+        if (!(selected & (1 << i)) || subscriptions[i].service != service)
+            continue;
+
+        g_debug ("Subscribing to '%s'...", subscriptions[i].name);
+        g_signal_connect (client,
+                          subscriptions[i].signal,
+                          subscriptions[i].indication,
+                          NULL);
+        if (subscriptions[i].enable)
+            subscriptions[i].enable (client, subscriptions[i].name);
+    }
+
+    allocate_next_client ();
+}
+
+static void
+allocate_next_client (void)
+{
+    json_t *json;
+    json_t *names;
+    guint i;
+
+    if (ctx->services->len) {
+        qmi_device_allocate_client (ctx->device,
+                                    g_array_index (ctx->services, QmiService, 0),
+                                    QMI_CID_NONE,
+                                    qmicli_request_timeout (ctx->request, 10),
+                                    ctx->cancellable,
+                                    (GAsyncReadyCallback)allocate_client_ready,
+                                    NULL);
+        return;
+    }
+
+    /* All set; wait for indications until cancelled */
+    ctx->cancelled_id = g_cancellable_connect (ctx->cancellable,
+                                               G_CALLBACK (subscriptions_cancelled),
+                                               NULL,
+                                               NULL);
+
+    json = event_new ("subscribed");
+    names = json_array ();
+    for (i = 0; i < G_N_ELEMENTS (subscriptions); i++) {
+        if (selected & (1 << i))
+            json_array_append_new (names, json_string (subscriptions[i].name));
+    }
+    json_object_set_new_nocheck (json, "subscriptions", names);
+    event_print (json);
+
+    if (ctx->history)
+        ctx->history_timeout_id = g_timeout_add_seconds (history_secs,
+                                                         (GSourceFunc)history_summary,
+                                                         NULL);
+}
+
+void
+qmicli_subscribe_run (QmiDevice *device,
+                      GCancellable *cancellable)
+{
+    guint i, j;
+
+    /* Initialize context */
+    ctx = g_slice_new0 (Context);
+    ctx->device = g_object_ref (device);
+    ctx->request = qmicli_request_new (cancellable, qmicli_get_deadline ());
+    ctx->cancellable = g_object_ref (qmicli_request_get_cancellable (ctx->request));
+    if (history_secs)
+        ctx->history = qmicli_history_new (HISTORY_CAPACITY, HISTORY_COLUMN_LAST);
+    if (sample_log_str) {
+        GError *error = NULL;
+
+        ctx->sample_log = qmicli_sample_log_open (sample_log_str,
+                                                  history_column_names,
+                                                  SAMPLE_LOG_MAX_SEGMENTS,
+                                                  &error);
+        if (!ctx->sample_log) {
+            qmicli_output_json (json_pack("{sbssss}",
+                 "success", 0,
+                 "error", "couldn't open sample log",
+                 "message", error->message
+                  ));
+            g_error_free (error);
+            context_free (ctx);
+            ctx = NULL;
+            qmicli_async_operation_done (FALSE);
+            return;
+        }
+    }
+
+    /* One client per service involved */
+    ctx->services = g_array_new (FALSE, FALSE, sizeof (QmiService));
+    for (i = 0; i < G_N_ELEMENTS (subscriptions); i++) {
+        if (!(selected & (1 << i)))
+            continue;
+
+        for (j = 0; j < ctx->services->len; j++) {
+            if (g_array_index (ctx->services, QmiService, j) == subscriptions[i].service)
+                break;
+        }
+        if (j == ctx->services->len)
+            g_array_append_val (ctx->services, subscriptions[i].service);
+    }
+
+    allocate_next_client ();
+}
+
+/*****************************************************************************/
+/* Sample log export */
+
+gboolean
+qmicli_subscribe_log_export_enabled (void)
+{
+    return !!sample_log_export_str;
+}
+
+typedef struct {
+    GString *buffer;
+    gboolean csv;
+    gboolean header_done;
+} ExportContext;
+
+static void
+export_flush (ExportContext *export)
+{
+    fwrite (export->buffer->str, 1, export->buffer->len, stdout);
+    g_string_truncate (export->buffer, 0);
+}
+
+/* Plain numbers only, so lines are formatted directly rather than built as
+ * JSON documents one by one */
+static void
+export_sample (const gchar *const *columns,
+               gint64 timestamp,
+               const gint16 *values,
+               ExportContext *export)
+{
+    guint i;
+
+    if (export->csv && !export->header_done) {
+        g_string_append (export->buffer, "timestamp");
+        for (i = 0; columns[i]; i++)
+            g_string_append_printf (export->buffer, ",%s", columns[i]);
+        g_string_append_c (export->buffer, '\n');
+        export->header_done = TRUE;
+    }
+
+    if (export->csv) {
+        g_string_append_printf (export->buffer, "%.6f", (gdouble)timestamp / G_USEC_PER_SEC);
+        for (i = 0; columns[i]; i++) {
+            if (values[i] == QMICLI_HISTORY_MISSING)
+                g_string_append_c (export->buffer, ',');
+            else
+                g_string_append_printf (export->buffer, ",%d", values[i]);
+        }
+    } else {
+        g_string_append_printf (export->buffer, "{\"timestamp\":%.6f", (gdouble)timestamp / G_USEC_PER_SEC);
+        for (i = 0; columns[i]; i++) {
+            if (values[i] != QMICLI_HISTORY_MISSING)
+                g_string_append_printf (export->buffer, ",\"%s\":%d", columns[i], values[i]);
+        }
+        g_string_append_c (export->buffer, '}');
+    }
+    g_string_append_c (export->buffer, '\n');
+
+    if (export->buffer->len >= 65536)
+        export_flush (export);
+}
+
+gboolean
+qmicli_subscribe_log_export (void)
+{
+    ExportContext export;
+    GError *error = NULL;
+    guint corrupt = 0;
+    gint64 from;
+    gint64 to;
+
+    from = sample_log_from_secs ? sample_log_from_secs * G_USEC_PER_SEC : G_MININT64;
+    to = sample_log_to_secs ? sample_log_to_secs * G_USEC_PER_SEC + (G_USEC_PER_SEC - 1) : G_MAXINT64;
+
+    export.buffer = g_string_sized_new (65536);
+    export.csv = (sample_log_format_str && g_str_equal (sample_log_format_str, "csv"));
+    export.header_done = FALSE;
+
+    if (!qmicli_sample_log_read (sample_log_export_str,
+                                 from,
+                                 to,
+                                 (QmicliSampleLogFunc)export_sample,
+                                 &export,
+                                 &corrupt,
+                                 &error)) {
+        g_string_free (export.buffer, TRUE);
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't read sample log",
+             "message", error->message
+              ));
+        g_error_free (error);
+        return FALSE;
+    }
+
+    export_flush (&export);
+    fflush (stdout);
+    g_string_free (export.buffer, TRUE);
+
+    if (corrupt)
+        g_warning ("Skipped %u sample log block(s) failing their CRC", corrupt);
+    return TRUE;
+}
@@ -0,0 +1,555 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * qmicli -- Command line interface to control QMI devices
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <libqmi-glib.h>
+
+#include "qmicli.h"
+
+/* Transcripts of the raw QMUX traffic with a device, one frame per line:
+ *
+ *   <microseconds since the epoch> <'>' to the device, '<' from it> <hex>
+ *
+ * In both modes the QmiDevice is given a pseudo-terminal instead of the
+ * real port. When recording, frames are passed between the two and written
+ * down; when replaying, each frame sent is answered with whatever the device
+ * sent after the matching one in the transcript, so every response goes
+ * through the very same parsers and handlers without any device. */
+
+#define TRANSCRIPT_HEADER "# qmicli transcript 1"
+#define QMUX_MARKER       0x01
+
+typedef struct {
+    gboolean from_device;
+    GByteArray *frame;
+} TranscriptEntry;
+
+typedef struct {
+    /* Pseudo-terminal the QmiDevice talks to */
+    gint master;
+    gchar *slave_path;
+    /* Kept open so that the master doesn't hang up while the QmiDevice
+     * doesn't have the slave open */
+    gint slave;
+    guint master_watch_id;
+    GByteArray *from_host;
+    /* Recording */
+    gint device;
+    guint device_watch_id;
+    GByteArray *from_device;
+    FILE *file;
+    /* Replaying */
+    GArray *entries;
+    guint cursor;
+    gboolean any_order;
+} Transcript;
+
+static Transcript *transcript;
+
+static void
+transcript_entry_clear (TranscriptEntry *entry)
+{
+    g_byte_array_unref (entry->frame);
+}
+
+static gboolean
+write_all (gint fd,
+           const guint8 *data,
+           gsize length)
+{
+    while (length > 0) {
+        gssize written;
+
+        written = write (fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            return FALSE;
+        }
+        data += written;
+        length -= written;
+    }
+    return TRUE;
+}
+
+/* Takes the next complete QMUX frame out of 'buffer', if any */
+static GByteArray *
+next_frame (GByteArray *buffer)
+{
+    GByteArray *frame;
+    gsize length;
+
+    /* Resynchronize on the marker after garbage */
+    while (buffer->len > 0 && buffer->data[0] != QMUX_MARKER)
+        g_byte_array_remove_index (buffer, 0);
+
+    if (buffer->len < 3)
+        return NULL;
+
+    /* The length doesn't include the marker */
+    length = 1 + (buffer->data[1] | (buffer->data[2] << 8));
+    if (buffer->len < length)
+        return NULL;
+
+    frame = g_byte_array_sized_new (length);
+    g_byte_array_append (frame, buffer->data, length);
+    g_byte_array_remove_range (buffer, 0, length);
+    return frame;
+}
+
+/* Appends whatever can be read from 'fd'; FALSE once it's gone */
+static gboolean
+read_into (gint fd,
+           GByteArray *buffer)
+{
+    guint8 chunk[4096];
+    gssize n_read;
+
+    n_read = read (fd, chunk, sizeof (chunk));
+    if (n_read < 0 && (errno == EINTR || errno == EAGAIN))
+        return TRUE;
+    if (n_read <= 0)
+        return FALSE;
+
+    g_byte_array_append (buffer, chunk, n_read);
+    return TRUE;
+}
+
+static void
+record_frame (gboolean from_device,
+              GByteArray *frame)
+{
+    guint i;
+
+    fprintf (transcript->file, "%" G_GINT64_FORMAT " %c ",
+             g_get_real_time (), from_device ? '<' : '>');
+    for (i = 0; i < frame->len; i++)
+        fprintf (transcript->file, "%02x", frame->data[i]);
+    fputc ('\n', transcript->file);
+}
+
+/* Sends the frames the device sent after the ones the host sent so far */
+static void
+replay_advance (void)
+{
+    while (transcript->cursor < transcript->entries->len) {
+        TranscriptEntry *entry;
+
+        entry = &g_array_index (transcript->entries, TranscriptEntry, transcript->cursor);
+        if (!entry->from_device)
+            return;
+
+        write_all (transcript->master, entry->frame->data, entry->frame->len);
+        transcript->cursor++;
+    }
+}
+
+/* QMUX header, then the QMI one, whose transaction id is a single byte for
+ * CTL only */
+#define QMUX_SERVICE_OFFSET 4
+#define QMUX_CLIENT_OFFSET  5
+#define QMI_TID_OFFSET      7
+
+static gboolean
+frame_parse_header (GByteArray *frame,
+                    guint8 *service,
+                    guint16 *transaction_id,
+                    guint16 *message_id)
+{
+    const guint8 *qmi;
+
+    if (frame->len < QMI_TID_OFFSET + 5)
+        return FALSE;
+
+    *service = frame->data[QMUX_SERVICE_OFFSET];
+    qmi = &frame->data[QMI_TID_OFFSET];
+    if (*service == QMI_SERVICE_CTL) {
+        *transaction_id = qmi[0];
+        qmi += 1;
+    } else {
+        *transaction_id = qmi[0] | (qmi[1] << 8);
+        qmi += 2;
+    }
+    *message_id = qmi[0] | (qmi[1] << 8);
+    return TRUE;
+}
+
+/* Answers with the first recorded response to the same message, given the
+ * client and transaction ids of the request */
+static void
+serve_frame (GByteArray *frame)
+{
+    guint8 service;
+    guint16 transaction_id;
+    guint16 message_id;
+    guint i;
+
+    if (!frame_parse_header (frame, &service, &transaction_id, &message_id))
+        return;
+
+    for (i = 0; i < transcript->entries->len; i++) {
+        TranscriptEntry *entry;
+        guint8 entry_service;
+        guint16 entry_transaction_id;
+        guint16 entry_message_id;
+        GByteArray *response;
+
+        entry = &g_array_index (transcript->entries, TranscriptEntry, i);
+        if (!entry->from_device ||
+            !frame_parse_header (entry->frame, &entry_service, &entry_transaction_id, &entry_message_id) ||
+            entry_service != service ||
+            entry_message_id != message_id ||
+            /* Indications have no transaction */
+            !entry_transaction_id)
+            continue;
+
+        response = g_byte_array_sized_new (entry->frame->len);
+        g_byte_array_append (response, entry->frame->data, entry->frame->len);
+        response->data[QMUX_CLIENT_OFFSET] = frame->data[QMUX_CLIENT_OFFSET];
+        response->data[QMI_TID_OFFSET] = transaction_id & 0xFF;
+        if (service != QMI_SERVICE_CTL)
+            response->data[QMI_TID_OFFSET + 1] = transaction_id >> 8;
+        write_all (transcript->master, response->data, response->len);
+        g_byte_array_unref (response);
+        return;
+    }
+
+    g_warning ("No response to message 0x%04x of service 0x%02x in the transcript",
+               message_id, service);
+}
+
+static void
+replay_frame (GByteArray *frame)
+{
+    TranscriptEntry *entry;
+
+    if (transcript->any_order) {
+        serve_frame (frame);
+        return;
+    }
+
+    if (transcript->cursor >= transcript->entries->len) {
+        g_warning ("Replay ran out of transcript; request left unanswered");
+        return;
+    }
+
+    /* Only frames from the device are left before the next request */
+    entry = &g_array_index (transcript->entries, TranscriptEntry, transcript->cursor);
+    if (entry->frame->len != frame->len ||
+        memcmp (entry->frame->data, frame->data, frame->len) != 0)
+        g_warning ("Replay diverged from the transcript at line %u", transcript->cursor + 2);
+    transcript->cursor++;
+
+    replay_advance ();
+}
+
+static gboolean
+master_readable (GIOChannel *channel,
+                 GIOCondition condition,
+                 gpointer unused)
+{
+    GByteArray *frame;
+
+    if (!read_into (transcript->master, transcript->from_host)) {
+        transcript->master_watch_id = 0;
+        return FALSE;
+    }
+
+    while ((frame = next_frame (transcript->from_host))) {
+        if (transcript->file) {
+            record_frame (FALSE, frame);
+            write_all (transcript->device, frame->data, frame->len);
+        } else
+            replay_frame (frame);
+        g_byte_array_unref (frame);
+    }
+    return TRUE;
+}
+
+static gboolean
+device_readable (GIOChannel *channel,
+                 GIOCondition condition,
+                 gpointer unused)
+{
+    GByteArray *frame;
+
+    if (!read_into (transcript->device, transcript->from_device)) {
+        transcript->device_watch_id = 0;
+        return FALSE;
+    }
+
+    while ((frame = next_frame (transcript->from_device))) {
+        record_frame (TRUE, frame);
+        write_all (transcript->master, frame->data, frame->len);
+        g_byte_array_unref (frame);
+    }
+    return TRUE;
+}
+
+static guint
+add_watch (gint fd,
+           GIOFunc func)
+{
+    GIOChannel *channel;
+    guint id;
+
+    channel = g_io_channel_unix_new (fd);
+    id = g_io_add_watch (channel, G_IO_IN | G_IO_HUP | G_IO_ERR, func, NULL);
+    g_io_channel_unref (channel);
+    return id;
+}
+
+static gboolean
+transcript_open_pty (GError **error)
+{
+    struct termios tio;
+    const gchar *name;
+
+    transcript->master = posix_openpt (O_RDWR | O_NOCTTY);
+    if (transcript->master < 0 ||
+        grantpt (transcript->master) < 0 ||
+        unlockpt (transcript->master) < 0 ||
+        !(name = ptsname (transcript->master))) {
+        g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                     "couldn't create pseudo-terminal: %s", g_strerror (errno));
+        return FALSE;
+    }
+
+    transcript->slave_path = g_strdup (name);
+    transcript->slave = open (transcript->slave_path, O_RDWR | O_NOCTTY);
+    if (transcript->slave < 0) {
+        g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                     "couldn't open pseudo-terminal '%s': %s",
+                     transcript->slave_path, g_strerror (errno));
+        return FALSE;
+    }
+
+    /* QMUX frames are binary; no line discipline at all */
+    if (tcgetattr (transcript->slave, &tio) == 0) {
+        cfmakeraw (&tio);
+        tcsetattr (transcript->slave, TCSANOW, &tio);
+    }
+
+    transcript->from_host = g_byte_array_new ();
+    transcript->master_watch_id = add_watch (transcript->master, master_readable);
+    return TRUE;
+}
+
+static Transcript *
+transcript_new (void)
+{
+    Transcript *self;
+
+    self = g_slice_new0 (Transcript);
+    self->master = -1;
+    self->slave = -1;
+    self->device = -1;
+    return self;
+}
+
+/* Returns the path the QmiDevice should use instead of 'device_path' */
+gchar *
+qmicli_transcript_record (const gchar *device_path,
+                          const gchar *transcript_path,
+                          GError **error)
+{
+    g_return_val_if_fail (!transcript, NULL);
+
+    transcript = transcript_new ();
+
+    transcript->file = fopen (transcript_path, "w");
+    if (!transcript->file) {
+        g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                     "couldn't create transcript '%s': %s",
+                     transcript_path, g_strerror (errno));
+        goto out_error;
+    }
+    fprintf (transcript->file, TRANSCRIPT_HEADER "\n");
+
+    transcript->device = open (device_path, O_RDWR | O_NOCTTY);
+    if (transcript->device < 0) {
+        g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                     "couldn't open '%s': %s", device_path, g_strerror (errno));
+        goto out_error;
+    }
+
+    if (!transcript_open_pty (error))
+        goto out_error;
+
+    transcript->from_device = g_byte_array_new ();
+    transcript->device_watch_id = add_watch (transcript->device, device_readable);
+    return g_strdup (transcript->slave_path);
+
+out_error:
+    qmicli_transcript_stop ();
+    return NULL;
+}
+
+static gboolean
+transcript_load (const gchar *transcript_path,
+                 GError **error)
+{
+    gchar *contents;
+    gchar **lines;
+    guint i;
+
+    if (!g_file_get_contents (transcript_path, &contents, NULL, error))
+        return FALSE;
+
+    lines = g_strsplit (contents, "\n", -1);
+    g_free (contents);
+
+    if (!lines[0] || !g_str_equal (lines[0], TRANSCRIPT_HEADER)) {
+        g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                     "'%s' is not a qmicli transcript", transcript_path);
+        g_strfreev (lines);
+        return FALSE;
+    }
+
+    transcript->entries = g_array_new (FALSE, FALSE, sizeof (TranscriptEntry));
+    g_array_set_clear_func (transcript->entries, (GDestroyNotify)transcript_entry_clear);
+
+    for (i = 1; lines[i]; i++) {
+        TranscriptEntry entry;
+        gchar **fields;
+        gsize length;
+        gsize j;
+
+        if (!lines[i][0] || lines[i][0] == '#')
+            continue;
+
+        fields = g_strsplit (lines[i], " ", 3);
+        length = fields[0] && fields[1] && fields[2] ? strlen (fields[2]) : 0;
+        if (!length || length % 2 ||
+            (!g_str_equal (fields[1], "<") && !g_str_equal (fields[1], ">"))) {
+            g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                         "invalid transcript line %u", i + 1);
+            g_strfreev (fields);
+            g_strfreev (lines);
+            return FALSE;
+        }
+
+        entry.from_device = (fields[1][0] == '<');
+        entry.frame = g_byte_array_sized_new (length / 2);
+        for (j = 0; j < length; j += 2) {
+            gint high;
+            gint low;
+            guint8 byte;
+
+            high = g_ascii_xdigit_value (fields[2][j]);
+            low = g_ascii_xdigit_value (fields[2][j + 1]);
+            if (high < 0 || low < 0) {
+                g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                             "invalid transcript line %u", i + 1);
+                g_byte_array_unref (entry.frame);
+                g_strfreev (fields);
+                g_strfreev (lines);
+                return FALSE;
+            }
+            byte = (high << 4) | low;
+            g_byte_array_append (entry.frame, &byte, 1);
+        }
+        g_array_append_val (transcript->entries, entry);
+        g_strfreev (fields);
+    }
+
+    g_strfreev (lines);
+    return TRUE;
+}
+
+/* Returns the path the QmiDevice should use */
+gchar *
+qmicli_transcript_replay (const gchar *transcript_path,
+                          GError **error)
+{
+    g_return_val_if_fail (!transcript, NULL);
+
+    transcript = transcript_new ();
+
+    if (!transcript_load (transcript_path, error) ||
+        !transcript_open_pty (error)) {
+        qmicli_transcript_stop ();
+        return NULL;
+    }
+
+    /* Anything the device sent before being asked */
+    replay_advance ();
+    return g_strdup (transcript->slave_path);
+}
+
+/* Like qmicli_transcript_replay(), but requests may come in any order and
+ * with any client and transaction ids; indications are not sent */
+gchar *
+qmicli_transcript_serve (const gchar *transcript_path,
+                         GError **error)
+{
+    g_return_val_if_fail (!transcript, NULL);
+
+    transcript = transcript_new ();
+    transcript->any_order = TRUE;
+
+    if (!transcript_load (transcript_path, error) ||
+        !transcript_open_pty (error)) {
+        qmicli_transcript_stop ();
+        return NULL;
+    }
+
+    return g_strdup (transcript->slave_path);
+}
+
+void
+qmicli_transcript_stop (void)
+{
+    if (!transcript)
+        return;
+
+    if (transcript->master_watch_id)
+        g_source_remove (transcript->master_watch_id);
+    if (transcript->device_watch_id)
+        g_source_remove (transcript->device_watch_id);
+    if (transcript->slave >= 0)
+        close (transcript->slave);
+    if (transcript->master >= 0)
+        close (transcript->master);
+    if (transcript->device >= 0)
+        close (transcript->device);
+    if (transcript->file)
+        fclose (transcript->file);
+    if (transcript->from_host)
+        g_byte_array_unref (transcript->from_host);
+    if (transcript->from_device)
+        g_byte_array_unref (transcript->from_device);
+    if (transcript->entries)
+        g_array_unref (transcript->entries);
+    g_free (transcript->slave_path);
+    g_slice_free (Transcript, transcript);
+    transcript = NULL;
+}
@@ -32,12 +32,14 @@
 
 #include "qmicli.h"
 #include "qmicli-helpers.h"
+#include "qmicli-json-generated.h"
 
 /* Context */
 typedef struct {
     QmiDevice *device;
     QmiClientUim *client;
     GCancellable *cancellable;
+    QmicliRequest *request;
 } Context;
 static Context *ctx;
 
@@ -97,10 +99,10 @@ qmicli_uim_options_enabled (void)
                  noop_flag);
 
     if (n_actions > 1) {
-        g_print ("%s\n", json_dumps(json_pack("{sbss}",
+        qmicli_output_json (json_pack("{sbss}",
              "success", 0,
              "error", "too many uim actions requested"
-              ),json_print_flag));
+              ));
         exit (EXIT_FAILURE);
     }
 
@@ -117,6 +119,7 @@ context_free (Context *context)
     if (context->client)
         g_object_unref (context->client);
     g_object_unref (context->cancellable);
+    qmicli_request_free (context->request);
     g_object_unref (context->device);
     g_slice_free (Context, context);
 }
@@ -138,33 +141,33 @@ reset_ready (QmiClientUim *client,
 
     output = qmi_client_uim_reset_finish (client, res, &error);
     if (!output) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "operation failed",
              "message", error->message
-              ),json_print_flag));
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_uim_reset_output_get_result (output, &error)) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "couldn't reset the uim service",
              "message", error->message
-              ),json_print_flag));
+              ));
         g_error_free (error);
         qmi_message_uim_reset_output_unref (output);
         shutdown (FALSE);
         return;
     }
 
-    g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+    qmicli_output_json (json_pack("{sbssss}",
              "success", 1,
              "device", qmi_device_get_path_display (ctx->device),
              "message", "successfully performed uim service reset"
-              ),json_print_flag));
+              ));
 
     qmi_message_uim_reset_output_unref (output);
     shutdown (TRUE);
@@ -187,11 +190,11 @@ get_sim_file_id_and_path (const gchar *file_path_str,
 
     split = g_strsplit (file_path_str, ",", -1);
     if (!split) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "invalid file path given",
              "message", file_path_str
-              ),json_print_flag));
+              ));
         return FALSE;
     }
 
@@ -224,11 +227,11 @@ get_sim_file_id_and_path (const gchar *file_path_str,
 
     if (*file_id == 0) {
         g_array_unref (*file_path);
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "invalid file path given",
              "message", file_path_str
-              ),json_print_flag));
+              ));
         return FALSE;
     }
 
@@ -241,18 +244,15 @@ read_transparent_ready (QmiClientUim *client,
 {
     QmiMessageUimReadTransparentOutput *output;
     GError *error = NULL;
-    guint8 sw1 = 0;
-    guint8 sw2 = 0;
-    GArray *read_result = NULL;
     json_t *json_output;
 
     output = qmi_client_uim_read_transparent_finish (client, res, &error);
     if (!output) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "operation failed",
              "message", error->message
-              ),json_print_flag));
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
@@ -267,26 +267,9 @@ read_transparent_ready (QmiClientUim *client,
               );
         g_error_free (error);
 
-        /* Card result */
-        if (qmi_message_uim_read_transparent_output_get_card_result (
-                output,
-                &sw1,
-                &sw2,
-                NULL)) {
-            gchar sw1result[6];
-            gchar sw2result[6];
-
-            g_snprintf(sw1result,5,"0x%02x",sw1);
-            g_snprintf(sw2result,5,"0x%02x",sw2);
-            json_object_update(json_output, json_pack("{s{ssss}}",
-                 "card result",
-                         "sw1", sw1result,
-                         "sw2", sw2result
-                 ));
-        }
+        qmicli_json_uim_read_transparent_output (output, json_output);
 
-        g_print ("%s\n", json_dumps(json_output,json_print_flag) ? : JSON_OUTPUT_ERROR);
-        g_free(json_output);
+        qmicli_output_json (json_output);
 
         qmi_message_uim_read_transparent_output_unref (output);
         shutdown (FALSE);
@@ -297,40 +280,9 @@ read_transparent_ready (QmiClientUim *client,
              "device", qmi_device_get_path_display (ctx->device)
               );
 
-    /* Card result */
-    if (qmi_message_uim_read_transparent_output_get_card_result (
-            output,
-            &sw1,
-            &sw2,
-            NULL)) {
-            gchar sw1result[6];
-            gchar sw2result[6];
-
-            g_snprintf(sw1result,5,"0x%02x",sw1);
-            g_snprintf(sw2result,5,"0x%02x",sw2);
-            json_object_update(json_output, json_pack("{s{ssss}}",
-                 "card result",
-                         "sw1", sw1result,
-                         "sw2", sw2result
-                 ));
-    }
-
-    /* Read result */
-    if (qmi_message_uim_read_transparent_output_get_read_result (
-            output,
-            &read_result,
-            NULL)) {
-        gchar *str;
-
-        str = qmicli_get_raw_data_printable (read_result, 80, "");
-        json_object_update(json_output, json_pack("{ss}",
-                 "read result", str
-                 ));
-        g_free (str);
-    }
+    qmicli_json_uim_read_transparent_output (output, json_output);
 
-    g_print ("%s\n", json_dumps(json_output,json_print_flag) ? : JSON_OUTPUT_ERROR);
-    g_free(json_output);
+    qmicli_output_json (json_output);
 
     qmi_message_uim_read_transparent_output_unref (output);
     shutdown (TRUE);
@@ -369,33 +321,15 @@ get_file_attributes_ready (QmiClientUim *client,
 {
     QmiMessageUimGetFileAttributesOutput *output;
     GError *error = NULL;
-    guint8 sw1 = 0;
-    guint8 sw2 = 0;
-    guint16 file_size;
-    guint16 file_id;
-    QmiUimFileType file_type;
-    guint16 record_size;
-    guint16 record_count;
-    QmiUimSecurityAttributeLogic read_security_attributes_logic;
-    QmiUimSecurityAttribute read_security_attributes;
-    QmiUimSecurityAttributeLogic write_security_attributes_logic;
-    QmiUimSecurityAttribute write_security_attributes;
-    QmiUimSecurityAttributeLogic increase_security_attributes_logic;
-    QmiUimSecurityAttribute increase_security_attributes;
-    QmiUimSecurityAttributeLogic deactivate_security_attributes_logic;
-    QmiUimSecurityAttribute deactivate_security_attributes;
-    QmiUimSecurityAttributeLogic activate_security_attributes_logic;
-    QmiUimSecurityAttribute activate_security_attributes;
-    GArray *raw = NULL;
     json_t *json_output;
 
     output = qmi_client_uim_get_file_attributes_finish (client, res, &error);
     if (!output) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "operation failed",
              "message", error->message
-              ),json_print_flag));
+              ));
         g_error_free (error);
         shutdown (FALSE);
         g_free (file_name);
@@ -411,26 +345,9 @@ get_file_attributes_ready (QmiClientUim *client,
               );
         g_error_free (error);
 
-        /* Card result */
-        if (qmi_message_uim_get_file_attributes_output_get_card_result (
-                output,
-                &sw1,
-                &sw2,
-                NULL)) {
-            gchar sw1result[6];
-            gchar sw2result[6];
-
-            g_snprintf(sw1result,5,"0x%02x",sw1);
-            g_snprintf(sw2result,5,"0x%02x",sw2);
-            json_object_update(json_output, json_pack("{s{ssss}}",
-                 "card result",
-                         "sw1", sw1result,
-                         "sw2", sw2result
-                 ));
-        }
+        qmicli_json_uim_get_file_attributes_output (output, json_output);
 
-        g_print ("%s\n", json_dumps(json_output,json_print_flag) ? : JSON_OUTPUT_ERROR);
-        g_free(json_output);
+        qmicli_output_json (json_output);
 
         qmi_message_uim_get_file_attributes_output_unref (output);
         shutdown (FALSE);
@@ -444,119 +361,9 @@ get_file_attributes_ready (QmiClientUim *client,
              "file name", file_name ? : "(null)"
               );
 
-    /* Card result */
-    if (qmi_message_uim_get_file_attributes_output_get_card_result (
-            output,
-            &sw1,
-            &sw2,
-            NULL)) {
-            gchar sw1result[6];
-            gchar sw2result[6];
-
-            g_snprintf(sw1result,5,"0x%02x",sw1);
-            g_snprintf(sw2result,5,"0x%02x",sw2);
-            json_object_update(json_output, json_pack("{s{ssss}}",
-                 "card result",
-                         "sw1", sw1result,
-                         "sw2", sw2result
-                 ));
-    }
-
-    /* File attributes */
-    if (qmi_message_uim_get_file_attributes_output_get_file_attributes (
-            output,
-            &file_size,
-            &file_id,
-            &file_type,
-            &record_size,
-            &record_count,
-            &read_security_attributes_logic,
-            &read_security_attributes,
-            &write_security_attributes_logic,
-            &write_security_attributes,
-            &increase_security_attributes_logic,
-            &increase_security_attributes,
-            &deactivate_security_attributes_logic,
-            &deactivate_security_attributes,
-            &activate_security_attributes_logic,
-            &activate_security_attributes,
-            &raw,
-            NULL)) {
-        gchar *str;
-
-        json_object_update(json_output, json_pack("{s{}}",
-                 "file attributes"
-                 ));
-
-        json_object_update(json_object_get(json_output,"file attributes"), json_pack("{si}",
-                 "file size", (guint)file_size
-                 ));
-
-        json_object_update(json_object_get(json_output,"file attributes"), json_pack("{si}",
-                 "file id", (guint)file_id
-                 ));
-
-        json_object_update(json_object_get(json_output,"file attributes"), json_pack("{ss}",
-                 "file type", qmi_uim_file_type_get_string (file_type)
-                 ));
-
-        json_object_update(json_object_get(json_output,"file attributes"), json_pack("{si}",
-                 "record size", (guint)record_size
-                 ));
-
-        json_object_update(json_object_get(json_output,"file attributes"), json_pack("{si}",
-                 "record count", (guint)record_count
-                 ));
-
-        str = qmi_uim_security_attribute_build_string_from_mask (read_security_attributes);
-        json_object_update(json_object_get(json_output,"file attributes"), json_pack("{s{ssss}}",
-                 "read security",
-                           "logic", qmi_uim_security_attribute_logic_get_string (read_security_attributes_logic),
-                           "attributes", str ? : "(null)"
-                 ));
-        g_free (str);
-
-        str = qmi_uim_security_attribute_build_string_from_mask (write_security_attributes);
-        json_object_update(json_object_get(json_output,"file attributes"), json_pack("{s{ssss}}",
-                 "write security",
-                           "logic", qmi_uim_security_attribute_logic_get_string (write_security_attributes_logic),
-                           "attributes", str ? : "(null)"
-                 ));
-        g_free (str);
-
-        str = qmi_uim_security_attribute_build_string_from_mask (increase_security_attributes);
-        json_object_update(json_object_get(json_output,"file attributes"), json_pack("{s{ssss}}",
-                 "increase security",
-                           "logic", qmi_uim_security_attribute_logic_get_string (increase_security_attributes_logic),
-                           "attributes", str ? : "(null)"
-                 ));
-        g_free (str);
-
-        str = qmi_uim_security_attribute_build_string_from_mask (deactivate_security_attributes);
-        json_object_update(json_object_get(json_output,"file attributes"), json_pack("{s{ssss}}",
-                 "deactivate security",
-                           "logic", qmi_uim_security_attribute_logic_get_string (deactivate_security_attributes_logic),
-                           "attributes", str ? : "(null)"
-                 ));
-        g_free (str);
-
-        str = qmi_uim_security_attribute_build_string_from_mask (activate_security_attributes);
-        json_object_update(json_object_get(json_output,"file attributes"), json_pack("{s{ssss}}",
-                 "activate security",
-                           "logic", qmi_uim_security_attribute_logic_get_string (activate_security_attributes_logic),
-                           "attributes", str ? : "(null)"
-                 ));
-        g_free (str);
-
-        str = qmicli_get_raw_data_printable (raw, 80, "");
-        json_object_update(json_output, json_pack("{ss}",
-                 "raw", str
-                 ));
-        g_free (str);
-    }
+    qmicli_json_uim_get_file_attributes_output (output, json_output);
 
-    g_print ("%s\n", json_dumps(json_output,json_print_flag) ? : JSON_OUTPUT_ERROR);
-    g_free(json_output);
+    qmicli_output_json (json_output);
 
     qmi_message_uim_get_file_attributes_output_unref (output);
     shutdown (TRUE);
@@ -596,7 +403,8 @@ qmicli_uim_run (QmiDevice *device,
     ctx = g_slice_new (Context);
     ctx->device = g_object_ref (device);
     ctx->client = g_object_ref (client);
-    ctx->cancellable = g_object_ref (cancellable);
+    ctx->request = qmicli_request_new (cancellable, qmicli_get_deadline ());
+    ctx->cancellable = g_object_ref (qmicli_request_get_cancellable (ctx->request));
 
     /* Request to read a transparent file? */
     if (read_transparent_str) {
@@ -612,7 +420,7 @@ qmicli_uim_run (QmiDevice *device,
                  read_transparent_str);
         qmi_client_uim_read_transparent (ctx->client,
                                          input,
-                                         10,
+                                         qmicli_request_timeout (ctx->request, 10),
                                          ctx->cancellable,
                                          (GAsyncReadyCallback)read_transparent_ready,
                                          NULL);
@@ -634,7 +442,7 @@ qmicli_uim_run (QmiDevice *device,
                  get_file_attributes_str);
         qmi_client_uim_get_file_attributes (ctx->client,
                                             input,
-                                            10,
+                                            qmicli_request_timeout (ctx->request, 10),
                                             ctx->cancellable,
                                             (GAsyncReadyCallback)get_file_attributes_ready,
                                             NULL);
@@ -647,7 +455,7 @@ qmicli_uim_run (QmiDevice *device,
         g_debug ("Asynchronously resetting UIM service...");
         qmi_client_uim_reset (ctx->client,
                               NULL,
-                              10,
+                              qmicli_request_timeout (ctx->request, 10),
                               ctx->cancellable,
                               (GAsyncReadyCallback)reset_ready,
                               NULL);
@@ -0,0 +1,118 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * qmicli -- Command line interface to control QMI devices
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include <libqmi-glib.h>
+
+#include "qmicli.h"
+#include "qmicli-helpers.h"
+
+/* Service version info reported by each device, in a key file replaced
+ * atomically on every save */
+
+#define VERSION_INFO_CACHE_GROUP "services"
+
+gchar *
+qmicli_version_info_cache_get_path (const gchar *device_path)
+{
+    return qmicli_get_runtime_file_path (device_path, "services");
+}
+
+GArray *
+qmicli_version_info_cache_load (const gchar *cache_path)
+{
+    GKeyFile *key_file;
+    GArray *services = NULL;
+    gchar **keys;
+    guint i;
+
+    key_file = g_key_file_new ();
+    if (!g_key_file_load_from_file (key_file, cache_path, G_KEY_FILE_NONE, NULL)) {
+        g_key_file_free (key_file);
+        return NULL;
+    }
+
+    keys = g_key_file_get_keys (key_file, VERSION_INFO_CACHE_GROUP, NULL, NULL);
+    for (i = 0; keys && keys[i]; i++) {
+        QmiDeviceServiceVersionInfo info;
+        gint *version;
+        gsize length = 0;
+        guint service;
+
+        version = g_key_file_get_integer_list (key_file, VERSION_INFO_CACHE_GROUP, keys[i], &length, NULL);
+        if (length != 2 ||
+            !qmicli_read_uint_from_string (keys[i], &service) ||
+            service > G_MAXUINT8) {
+            g_free (version);
+            continue;
+        }
+
+        if (!services)
+            services = g_array_new (FALSE, FALSE, sizeof (QmiDeviceServiceVersionInfo));
+        info.service = (QmiService)service;
+        info.major_version = (guint16)version[0];
+        info.minor_version = (guint16)version[1];
+        g_array_append_val (services, info);
+        g_free (version);
+    }
+
+    g_strfreev (keys);
+    g_key_file_free (key_file);
+    return services;
+}
+
+gboolean
+qmicli_version_info_cache_save (const gchar *cache_path,
+                                GArray *services,
+                                GError **error)
+{
+    GKeyFile *key_file;
+    gchar *dirname;
+    gchar *data;
+    gsize length;
+    gboolean saved;
+    guint i;
+
+    key_file = g_key_file_new ();
+    for (i = 0; i < services->len; i++) {
+        QmiDeviceServiceVersionInfo *info;
+        gint version[2];
+        gchar *key;
+
+        info = &g_array_index (services, QmiDeviceServiceVersionInfo, i);
+        version[0] = info->major_version;
+        version[1] = info->minor_version;
+        key = g_strdup_printf ("%u", (guint)info->service);
+        g_key_file_set_integer_list (key_file, VERSION_INFO_CACHE_GROUP, key, version, 2);
+        g_free (key);
+    }
+
+    dirname = g_path_get_dirname (cache_path);
+    g_mkdir_with_parents (dirname, 0700);
+    g_free (dirname);
+
+    /* Written atomically, so readers never need a lock */
+    data = g_key_file_to_data (key_file, &length, NULL);
+    saved = g_file_set_contents (cache_path, data, length, error);
+    g_free (data);
+    g_key_file_free (key_file);
+    return saved;
+}
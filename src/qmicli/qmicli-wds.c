@@ -31,26 +31,59 @@
 #include <libqmi-glib.h>
 
 #include "qmicli.h"
+#include "qmicli-json-generated.h"
+
+/* One of the two sessions of a dual-stack bring-up */
+typedef struct {
+    const gchar *name;
+    QmiWdsIpFamily ip_family;
+    QmiClientWds *client;
+    QmicliRequest *request;
+    QmicliJob *job;
+    json_t *json_result;
+} DualStackSession;
 
 /* Context */
 typedef struct {
     QmiDevice *device;
     QmiClientWds *client;
     GCancellable *cancellable;
+    QmicliRequest *request;
 
     /* Helpers for the wds-start-network command */
     gulong network_started_id;
     guint packet_status_timeout_id;
     guint32 packet_data_handle;
+
+    /* Helpers for the wds-follow-network-reconnect option */
+    QmiMessageWdsStartNetworkInput *start_network_input;
+    gboolean connected;
+    gboolean reconnect_pending;
+    guint reconnect_timeout_id;
+    guint reconnect_attempts;
+    GTimer *disconnected_timer;
+
+    /* Helpers for the wds-start-network-dual command */
+    DualStackSession dual[2];
+    guint dual_pending;
+    gboolean dual_success;
 } Context;
 static Context *ctx;
 
+/* Read-only query shared with identical ones in flight, and answered from
+ * memory while its last response is fresh enough */
+static const QmicliCoalescedMessage get_packet_service_status_message =
+    QMICLI_COALESCED_MESSAGE (wds, get_packet_service_status, 1000);
+
 /* Options */
 static gchar *start_network_str;
+static gchar *start_network_dual_str;
 static gboolean follow_network_flag;
+static gboolean follow_network_reconnect_flag;
 static gchar *stop_network_str;
 static gboolean get_packet_service_status_flag;
 static gboolean get_packet_statistics_flag;
+static gchar *get_packet_statistics_str;
 static gboolean get_data_bearer_technology_flag;
 static gboolean get_current_data_bearer_technology_flag;
 static gchar *get_profile_list_str;
@@ -58,15 +91,35 @@ static gchar *get_default_settings_str;
 static gboolean reset_flag;
 static gboolean noop_flag;
 
+static gboolean
+get_packet_statistics_cb (const gchar *option_name,
+                          const gchar *value,
+                          gpointer user_data,
+                          GError **error)
+{
+    get_packet_statistics_flag = TRUE;
+    g_free (get_packet_statistics_str);
+    get_packet_statistics_str = g_strdup (value);
+    return TRUE;
+}
+
 static GOptionEntry entries[] = {
     { "wds-start-network", 0, 0, G_OPTION_ARG_STRING, &start_network_str,
       "Start network (Authentication, Username and Password are optional)",
       "[(APN),(PAP|CHAP|BOTH),(Username),(Password)]"
     },
+    { "wds-start-network-dual", 0, 0, G_OPTION_ARG_STRING, &start_network_dual_str,
+      "Start IPv4 and IPv6 networks concurrently, on two clients (Authentication, Username and Password are optional)",
+      "[(APN),(PAP|CHAP|BOTH),(Username),(Password)]"
+    },
     { "wds-follow-network", 0, 0, G_OPTION_ARG_NONE, &follow_network_flag,
       "Follow the network status until disconnected. Use with `--wds-start-network'",
       NULL
     },
+    { "wds-follow-network-reconnect", 0, 0, G_OPTION_ARG_NONE, &follow_network_reconnect_flag,
+      "Restart the network with backoff whenever disconnected, until cancelled. Use with `--wds-follow-network'",
+      NULL
+    },
     { "wds-stop-network", 0, 0, G_OPTION_ARG_STRING, &stop_network_str,
       "Stop network",
       "[Packet data handle]"
@@ -75,9 +128,9 @@ static GOptionEntry entries[] = {
       "Get packet service status",
       NULL
     },
-    { "wds-get-packet-statistics", 0, 0, G_OPTION_ARG_NONE, &get_packet_statistics_flag,
-      "Get packet statistics",
-      NULL
+    { "wds-get-packet-statistics", 0, G_OPTION_FLAG_OPTIONAL_ARG, G_OPTION_ARG_CALLBACK, get_packet_statistics_cb,
+      "Get packet statistics, optionally only the given counters",
+      "[all|packets,errors,overflows,bytes,drops]"
     },
     { "wds-get-data-bearer-technology", 0, 0, G_OPTION_ARG_NONE, &get_data_bearer_technology_flag,
       "Get data bearer technology",
@@ -131,6 +184,7 @@ qmicli_wds_options_enabled (void)
         return !!n_actions;
 
     n_actions = (!!start_network_str +
+                 !!start_network_dual_str +
                  !!stop_network_str +
                  get_packet_service_status_flag +
                  get_packet_statistics_flag +
@@ -142,17 +196,24 @@ qmicli_wds_options_enabled (void)
                  noop_flag);
 
     if (n_actions > 1) {
-        g_print ("%s\n", json_dumps(json_pack("{sbss}",
+        qmicli_output_json (json_pack("{sbss}",
              "success", 0,
              "error", "too many wds actions requested"
-              ),json_print_flag));
+              ));
         exit (EXIT_FAILURE);
-    } else if (n_actions == 0 &&
+    } else if (!start_network_str &&
                follow_network_flag) {
-        g_print ("%s\n", json_dumps(json_pack("{sbss}",
+        qmicli_output_json (json_pack("{sbss}",
              "success", 0,
              "error", "--wds-follow-network must be used with --wds-start-network"
-              ),json_print_flag));
+              ));
+        exit (EXIT_FAILURE);
+    } else if (follow_network_reconnect_flag &&
+               !follow_network_flag) {
+        qmicli_output_json (json_pack("{sbss}",
+             "success", 0,
+             "error", "--wds-follow-network-reconnect must be used with --wds-follow-network"
+              ));
         exit (EXIT_FAILURE);
     }
 
@@ -163,6 +224,8 @@ qmicli_wds_options_enabled (void)
 static void
 context_free (Context *context)
 {
+    guint i;
+
     if (!context)
         return;
 
@@ -172,7 +235,21 @@ context_free (Context *context)
         g_cancellable_disconnect (context->cancellable, context->network_started_id);
     if (context->packet_status_timeout_id)
         g_source_remove (context->packet_status_timeout_id);
+    if (context->reconnect_timeout_id)
+        g_source_remove (context->reconnect_timeout_id);
+    if (context->start_network_input)
+        qmi_message_wds_start_network_input_unref (context->start_network_input);
+    if (context->disconnected_timer)
+        g_timer_destroy (context->disconnected_timer);
+    for (i = 0; i < G_N_ELEMENTS (context->dual); i++) {
+        if (context->dual[i].client)
+            g_object_unref (context->dual[i].client);
+        if (context->dual[i].json_result)
+            json_decref (context->dual[i].json_result);
+        qmicli_request_free (context->dual[i].request);
+    }
     g_object_unref (context->cancellable);
+    qmicli_request_free (context->request);
     g_object_unref (context->device);
     g_slice_free (Context, context);
 }
@@ -194,22 +271,22 @@ stop_network_ready (QmiClientWds *client,
 
     output = qmi_client_wds_stop_network_finish (client, res, &error);
     if (!output) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "operation failed",
              "message", error->message
-              ),json_print_flag));
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_wds_stop_network_output_get_result (output, &error)) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "couldn't stop network",
              "message", error->message
-              ),json_print_flag));
+              ));
         g_error_free (error);
         qmi_message_wds_stop_network_output_unref (output);
         shutdown (FALSE);
@@ -219,11 +296,11 @@ stop_network_ready (QmiClientWds *client,
 #undef VALIDATE_UNKNOWN
 #define VALIDATE_UNKNOWN(str) (str ? str : "unknown")
 
-    g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+    qmicli_output_json (json_pack("{sbssss}",
              "success", 1,
              "device", qmi_device_get_path_display (ctx->device),
              "message", "network stopped"
-              ),json_print_flag));
+              ));
     qmi_message_wds_stop_network_output_unref (output);
     shutdown (TRUE);
 }
@@ -238,41 +315,265 @@ internal_stop_network (GCancellable *cancellable,
     qmi_message_wds_stop_network_input_set_packet_data_handle (input, packet_data_handle, NULL);
 
     /*g_print ("Network cancelled... releasing resources\n");
-    g_print ("%s\n", json_dumps(json_pack("{sbss}",
+    qmicli_output_json (json_pack("{sbss}",
              "success", 1,
              "message", "network cancelled, releasing resources"
-              ),json_print_flag));
+              ));
   */  
+    /* Cleanup after cancellation runs uncancellable, with a full timeout */
     qmi_client_wds_stop_network (ctx->client,
                                  input,
-                                 10,
-                                 ctx->cancellable,
+                                 cancellable ? qmicli_request_timeout (ctx->request, 10) : 10,
+                                 cancellable,
                                  (GAsyncReadyCallback)stop_network_ready,
                                  NULL);
     qmi_message_wds_stop_network_input_unref (input);
 }
 
+static gboolean
+reconnect_cancelled_idle (void)
+{
+    qmicli_output_json (json_pack("{sbssss}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device),
+             "message", "network cancelled while reconnecting"
+              ));
+    shutdown (TRUE);
+    return FALSE;
+}
+
 static void
 network_cancelled (GCancellable *cancellable)
 {
     ctx->network_started_id = 0;
 
-    /* Remove the timeout right away */
+    /* Remove the timeouts right away */
     if (ctx->packet_status_timeout_id) {
         g_source_remove (ctx->packet_status_timeout_id);
         ctx->packet_status_timeout_id = 0;
     }
+    if (ctx->reconnect_timeout_id) {
+        g_source_remove (ctx->reconnect_timeout_id);
+        ctx->reconnect_timeout_id = 0;
+    }
 
-    g_print ("%s\n", json_dumps(json_pack("{sbss}",
+    /* Nothing to stop while reconnecting; a pending start request finishes
+     * with a cancelled error and shuts down from there */
+    if (!ctx->connected) {
+        if (!ctx->reconnect_pending)
+            g_idle_add ((GSourceFunc)reconnect_cancelled_idle, NULL);
+        return;
+    }
+
+    qmicli_output_json (json_pack("{sbss}",
              "success", 1,
              "message", "network concelled, releasing resources"
-              ),json_print_flag));
-    internal_stop_network (cancellable, ctx->packet_data_handle);
+              ));
+    internal_stop_network (NULL, ctx->packet_data_handle);
+}
+
+static gboolean packet_status_timeout (void);
+static void schedule_reconnect (void);
+
+/* Build the start network input from the [(APN),(PAP|CHAP|BOTH),(Username),(Password)] string */
+static QmiMessageWdsStartNetworkInput *
+start_network_input_create (const gchar *str)
+{
+    QmiMessageWdsStartNetworkInput *input;
+    gchar **split;
+
+    input = qmi_message_wds_start_network_input_new ();
+
+    /* Use the input string as APN */
+    if (!str[0])
+        return input;
+
+    split = g_strsplit (str, ",", 0);
+    qmi_message_wds_start_network_input_set_apn (input, split[0], NULL);
+
+    if (split[1]) {
+        QmiWdsAuthentication qmiwdsauth;
+
+        /* Use authentication method */
+        if (g_ascii_strcasecmp (split[1], "PAP") == 0) {
+            qmiwdsauth = QMI_WDS_AUTHENTICATION_PAP;
+        } else if (g_ascii_strcasecmp (split[1], "CHAP") == 0) {
+            qmiwdsauth = QMI_WDS_AUTHENTICATION_CHAP;
+        } else if (g_ascii_strcasecmp (split[1], "BOTH") == 0) {
+            qmiwdsauth = (QMI_WDS_AUTHENTICATION_PAP | QMI_WDS_AUTHENTICATION_CHAP);
+        } else {
+            qmiwdsauth = QMI_WDS_AUTHENTICATION_NONE;
+        }
+
+        qmi_message_wds_start_network_input_set_authentication_preference (input, qmiwdsauth, NULL);
+
+        /* Username */
+        if (split[2] && strlen (split[2])) {
+            qmi_message_wds_start_network_input_set_username (input, split[2], NULL);
+
+            /* Password */
+            if (split[3] && strlen (split[3])) {
+                qmi_message_wds_start_network_input_set_password (input, split[3], NULL);
+            }
+        }
+    }
+    g_strfreev (split);
+
+    return input;
+}
+
+static void
+stale_stop_network_ready (QmiClientWds *client,
+                          GAsyncResult *res)
+{
+    QmiMessageWdsStopNetworkOutput *output;
+    GError *error = NULL;
+
+    /* The modem usually dropped the handle already; just log */
+    output = qmi_client_wds_stop_network_finish (client, res, &error);
+    if (output) {
+        qmi_message_wds_stop_network_output_get_result (output, &error);
+        qmi_message_wds_stop_network_output_unref (output);
+    }
+    if (error) {
+        g_debug ("couldn't stop stale network: %s", error->message);
+        g_error_free (error);
+    }
+}
+
+static void
+reconnect_start_network_ready (QmiClientWds *client,
+                               GAsyncResult *res)
+{
+    QmiMessageWdsStartNetworkOutput *output;
+    GError *error = NULL;
+
+    ctx->reconnect_pending = FALSE;
+
+    output = qmi_client_wds_start_network_finish (client, res, &error);
+    if (output)
+        qmi_message_wds_start_network_output_get_result (output, &error);
+
+    if (g_cancellable_is_cancelled (ctx->cancellable)) {
+        g_clear_error (&error);
+        if (output)
+            qmi_message_wds_start_network_output_unref (output);
+        reconnect_cancelled_idle ();
+        return;
+    }
+
+    if (error) {
+        qmicli_output_json (json_pack("{sbsssssssi}",
+             "success", 0,
+             "device", qmi_device_get_path_display (ctx->device),
+             "error", "couldn't reconnect",
+             "message", error->message,
+             "attempt", ctx->reconnect_attempts
+              ));
+        g_error_free (error);
+        if (output)
+            qmi_message_wds_start_network_output_unref (output);
+        schedule_reconnect ();
+        return;
+    }
+
+    qmi_message_wds_start_network_output_get_packet_data_handle (output, &ctx->packet_data_handle, NULL);
+    qmi_message_wds_start_network_output_unref (output);
+
+    qmicli_output_json (json_pack("{sbsssbsisisf}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device),
+             "reconnected", 1,
+             "packet data handle", (guint)ctx->packet_data_handle,
+             "attempts", ctx->reconnect_attempts,
+             "time to reconnect", g_timer_elapsed (ctx->disconnected_timer, NULL)
+              ));
+
+    /* Back to following the connection */
+    ctx->connected = TRUE;
+    ctx->reconnect_attempts = 0;
+    ctx->packet_status_timeout_id = g_timeout_add_seconds (20,
+                                                           (GSourceFunc)packet_status_timeout,
+                                                           NULL);
+}
+
+static gboolean
+reconnect_timeout (void)
+{
+    ctx->reconnect_timeout_id = 0;
+    ctx->reconnect_attempts++;
+    ctx->reconnect_pending = TRUE;
+
+    g_debug ("Asynchronously restarting network (attempt %u)...", ctx->reconnect_attempts);
+    qmi_client_wds_start_network (ctx->client,
+                                  ctx->start_network_input,
+                                  qmicli_request_timeout (ctx->request, 45),
+                                  ctx->cancellable,
+                                  (GAsyncReadyCallback)reconnect_start_network_ready,
+                                  NULL);
+    return FALSE;
+}
+
+/* Jittered exponential backoff: 2s doubling up to 5 minutes, each delay
+ * picked at random between half and the whole of it */
+#define RECONNECT_BACKOFF_MIN_MS 2000
+#define RECONNECT_BACKOFF_MAX_MS 300000
+
+static void
+schedule_reconnect (void)
+{
+    guint delay = RECONNECT_BACKOFF_MIN_MS;
+    guint i;
+
+    for (i = 0; i < ctx->reconnect_attempts && delay < RECONNECT_BACKOFF_MAX_MS; i++)
+        delay *= 2;
+    delay = MIN (delay, RECONNECT_BACKOFF_MAX_MS);
+    delay = g_random_int_range (delay / 2, delay + 1);
+
+    qmicli_output_json (json_pack("{sbsssbsf}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device),
+             "reconnecting", 1,
+             "retry in", (gdouble)delay / 1000.0
+              ));
+
+    ctx->reconnect_timeout_id = g_timeout_add (delay, (GSourceFunc)reconnect_timeout, NULL);
+}
+
+static void
+network_disconnected (void)
+{
+    QmiMessageWdsStopNetworkInput *input;
+
+    ctx->connected = FALSE;
+    if (ctx->packet_status_timeout_id) {
+        g_source_remove (ctx->packet_status_timeout_id);
+        ctx->packet_status_timeout_id = 0;
+    }
+
+    if (!ctx->disconnected_timer)
+        ctx->disconnected_timer = g_timer_new ();
+    else
+        g_timer_start (ctx->disconnected_timer);
+
+    /* Release whatever the modem may still hold for the old handle */
+    input = qmi_message_wds_stop_network_input_new ();
+    qmi_message_wds_stop_network_input_set_packet_data_handle (input, ctx->packet_data_handle, NULL);
+    qmi_client_wds_stop_network (ctx->client,
+                                 input,
+                                 10,
+                                 NULL,
+                                 (GAsyncReadyCallback)stale_stop_network_ready,
+                                 NULL);
+    qmi_message_wds_stop_network_input_unref (input);
+
+    schedule_reconnect ();
 }
 
 static void
 timeout_get_packet_service_status_ready (QmiClientWds *client,
-                                         GAsyncResult *res)
+                                         GAsyncResult *res,
+                                         QmicliJob *job)
 {
     GError *error = NULL;
     QmiMessageWdsGetPacketServiceStatusOutput *output;
@@ -280,22 +581,23 @@ timeout_get_packet_service_status_ready (QmiClientWds *client,
     json_t *json_output;
 
     output = qmi_client_wds_get_packet_service_status_finish (client, res, &error);
+    qmicli_scheduler_done (job);
     if (!output) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "operation failed",
              "message", error->message
-              ),json_print_flag));
+              ));
         g_error_free (error);
         return;
     }
 
     if (!qmi_message_wds_get_packet_service_status_output_get_result (output, &error)) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "couldn't get packet service status",
              "message", error->message
-              ),json_print_flag));
+              ));
         g_error_free (error);
         qmi_message_wds_get_packet_service_status_output_unref (output);
         return;
@@ -312,33 +614,109 @@ timeout_get_packet_service_status_ready (QmiClientWds *client,
              "connection status", qmi_wds_connection_status_get_string (status),
              "stopping", 0
               );
+    qmicli_coalesce_json_add_age (json_output, res);
     qmi_message_wds_get_packet_service_status_output_unref (output);
 
-    /* If packet service checks detect disconnection, halt --wds-follow-network */
+    /* Late reply after a disconnection was already handled */
+    if (!ctx->connected) {
+        json_decref (json_output);
+        return;
+    }
+
+    /* If packet service checks detect disconnection, either reconnect or
+     * halt --wds-follow-network */
     if (status != QMI_WDS_CONNECTION_STATUS_CONNECTED) {
-        json_object_update(json_output, json_pack("{sb}",
+        if (follow_network_reconnect_flag) {
+            qmicli_output_json_monitor ("wds-follow-network",
+                                        NULL,
+                                        json_output,
+                                        json_print_flag);
+            network_disconnected ();
+            return;
+        }
+        qmicli_json_object_update_new (json_output, json_pack("{sb}",
                 "stopping", 1
                 ));
         internal_stop_network (NULL, ctx->packet_data_handle);
     }
-    g_print ("%s\n", json_dumps(json_output,json_print_flag) ? : JSON_OUTPUT_ERROR);
-    g_free(json_output);
+    qmicli_output_json_monitor ("wds-follow-network",
+                                NULL,
+                                json_output,
+                                json_print_flag);
 
 }
 
+static void
+packet_status_job (QmicliJob *job,
+                   gpointer unused)
+{
+    qmicli_coalesce_call (&get_packet_service_status_message,
+                          G_OBJECT (ctx->client),
+                          NULL,
+                          NULL,
+                          qmicli_request_timeout (ctx->request, 10),
+                          ctx->cancellable,
+                          (GAsyncReadyCallback)timeout_get_packet_service_status_ready,
+                          job);
+}
+
 static gboolean
 packet_status_timeout (void)
 {
-    qmi_client_wds_get_packet_service_status (ctx->client,
-                                              NULL,
-                                              10,
-                                              ctx->cancellable,
-                                              (GAsyncReadyCallback)timeout_get_packet_service_status_ready,
-                                              NULL);
-
+    /* Polling yields to anything interactive on the same service */
+    qmicli_scheduler_submit (QMI_SERVICE_WDS,
+                             QMICLI_PRIORITY_PERIODIC,
+                             "wds-follow-network",
+                             packet_status_job,
+                             NULL);
     return TRUE;
 }
 
+/* Error details of a failed start network request, call end reasons included */
+static json_t *
+start_network_error_json (QmiMessageWdsStartNetworkOutput *output,
+                          const GError *error)
+{
+    json_t *json_output;
+
+    json_output = json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't start network",
+             "message", error->message
+              );
+
+    if (g_error_matches (error,
+                         QMI_PROTOCOL_ERROR,
+                         QMI_PROTOCOL_ERROR_CALL_FAILED)) {
+        QmiWdsCallEndReason cer;
+        QmiWdsVerboseCallEndReasonType verbose_cer_type;
+        gint16 verbose_cer_reason;
+
+        if (qmi_message_wds_start_network_output_get_call_end_reason (
+                output,
+                &cer,
+                NULL))
+            qmicli_json_object_update_new (json_output, json_pack("{siss}",
+                        "call end reason", cer,
+                        "call end reason text", qmi_wds_call_end_reason_get_string (cer)
+                        ));
+
+        if (qmi_message_wds_start_network_output_get_verbose_call_end_reason (
+                output,
+                &verbose_cer_type,
+                &verbose_cer_reason,
+                NULL))
+            qmicli_json_object_update_new (json_output, json_pack("{sisssiss}",
+                        "verbose call end type", verbose_cer_type,
+                        "verbose call end type text", qmi_wds_verbose_call_end_reason_type_get_string (verbose_cer_type),
+                        "verbose call end reason", verbose_cer_reason,
+                        "verbose call end reason text", qmi_wds_verbose_call_end_reason_get_string (verbose_cer_type, verbose_cer_reason)
+                        ));
+    }
+
+    return json_output;
+}
+
 static void
 start_network_ready (QmiClientWds *client,
                      GAsyncResult *res)
@@ -349,56 +727,21 @@ start_network_ready (QmiClientWds *client,
 
     output = qmi_client_wds_start_network_finish (client, res, &error);
     if (!output) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "operation failed",
              "message", error->message
-              ),json_print_flag));
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_wds_start_network_output_get_result (output, &error)) {
-        json_output = json_pack("{sbssss}",
-             "success", 0,
-             "error", "couldn't start network",
-             "message", error->message
-              );
-
-        if (g_error_matches (error,
-                             QMI_PROTOCOL_ERROR,
-                             QMI_PROTOCOL_ERROR_CALL_FAILED)) {
-            QmiWdsCallEndReason cer;
-            QmiWdsVerboseCallEndReasonType verbose_cer_type;
-            gint16 verbose_cer_reason;
-
-            if (qmi_message_wds_start_network_output_get_call_end_reason (
-                    output,
-                    &cer,
-                    NULL))
-                json_object_update(json_output, json_pack("{siss}",
-                            "call end reason", cer,
-                            "call end reason text", qmi_wds_call_end_reason_get_string (cer)
-                            ));
-
-            if (qmi_message_wds_start_network_output_get_verbose_call_end_reason (
-                    output,
-                    &verbose_cer_type,
-                    &verbose_cer_reason,
-                    NULL))
-                json_object_update(json_output, json_pack("{sisssiss}",
-                            "verbose call end type", verbose_cer_type,
-                            "verbose call end type text", qmi_wds_verbose_call_end_reason_type_get_string (verbose_cer_type),
-                            "verbose call end reason", verbose_cer_reason,
-                            "verbose call end reason text", qmi_wds_verbose_call_end_reason_get_string (verbose_cer_type, verbose_cer_reason)
-                            ));
-        }
-
+        json_output = start_network_error_json (output, error);
         g_error_free (error);
 
-        g_print ("%s\n", json_dumps(json_output,json_print_flag) ? : JSON_OUTPUT_ERROR);
-        g_free(json_output);
+        qmicli_output_json (json_output);
         qmi_message_wds_start_network_output_unref (output);
         shutdown (FALSE);
         return;
@@ -418,9 +761,10 @@ start_network_ready (QmiClientWds *client,
              );
 
     if (follow_network_flag) {
-        json_object_update(json_output, json_pack("{sb}",
+        qmicli_json_object_update_new (json_output, json_pack("{sb}",
              "break to abort network", 1
              ));
+        ctx->connected = TRUE;
         ctx->network_started_id = g_cancellable_connect (ctx->cancellable,
                                                          G_CALLBACK (network_cancelled),
                                                          NULL,
@@ -429,44 +773,196 @@ start_network_ready (QmiClientWds *client,
         ctx->packet_status_timeout_id = g_timeout_add_seconds (20,
                                                                (GSourceFunc)packet_status_timeout,
                                                                NULL);
-        g_print ("%s\n", json_dumps(json_output,json_print_flag) ? : JSON_OUTPUT_ERROR);
-        g_free(json_output);
+        qmicli_output_json (json_output);
         return;
 
     }
-    g_print ("%s\n", json_dumps(json_output,json_print_flag) ? : JSON_OUTPUT_ERROR);
-    g_free(json_output);
+    qmicli_output_json (json_output);
 
     /* Nothing else to do */
     shutdown (TRUE);
 }
 
+static void
+dual_release_client_ready (QmiDevice *device,
+                           GAsyncResult *res)
+{
+    GError *error = NULL;
+
+    if (!qmi_device_release_client_finish (device, res, &error)) {
+        g_debug ("couldn't release second WDS client: %s", error->message);
+        g_error_free (error);
+    }
+
+    shutdown (ctx->dual_success);
+}
+
+static void
+dual_session_done (void)
+{
+    json_t *json_output;
+    gboolean success;
+    guint i;
+
+    if (--ctx->dual_pending > 0)
+        return;
+
+    success = TRUE;
+    json_output = json_pack("{sbss}",
+             "success", 1,
+             "device", qmi_device_get_path_display (ctx->device)
+             );
+    for (i = 0; i < G_N_ELEMENTS (ctx->dual); i++) {
+        if (!json_is_true (json_object_get (ctx->dual[i].json_result, "success")))
+            success = FALSE;
+        json_object_del (ctx->dual[i].json_result, "success");
+        json_object_set (json_output, ctx->dual[i].name, ctx->dual[i].json_result);
+    }
+    json_object_set_new (json_output, "success", json_boolean (success));
+
+    qmicli_output_json (json_output);
+
+    ctx->dual_success = success;
+
+    /* The primary client is released by the caller, the second one here,
+     * honouring --client-no-release-cid in the same way */
+    if (!ctx->dual[1].client) {
+        shutdown (success);
+        return;
+    }
+
+    qmi_device_release_client (ctx->device,
+                               QMI_CLIENT (ctx->dual[1].client),
+                               qmicli_release_client_flags (),
+                               10,
+                               NULL,
+                               (GAsyncReadyCallback)dual_release_client_ready,
+                               NULL);
+}
+
+static void
+dual_start_network_ready (QmiClientWds *client,
+                          GAsyncResult *res,
+                          DualStackSession *session)
+{
+    GError *error = NULL;
+    QmiMessageWdsStartNetworkOutput *output;
+    guint32 packet_data_handle;
+
+    output = qmi_client_wds_start_network_finish (client, res, &error);
+    qmicli_scheduler_done (session->job);
+    session->job = NULL;
+    if (!output) {
+        session->json_result = json_pack("{sbssss}",
+             "success", 0,
+             "error", "operation failed",
+             "message", error->message
+              );
+        g_error_free (error);
+    } else if (!qmi_message_wds_start_network_output_get_result (output, &error)) {
+        session->json_result = start_network_error_json (output, error);
+        g_error_free (error);
+    } else {
+        qmi_message_wds_start_network_output_get_packet_data_handle (output, &packet_data_handle, NULL);
+        session->json_result = json_pack("{sbsisi}",
+             "success", 1,
+             "packet data handle", (guint)packet_data_handle,
+             "cid", (guint)qmi_client_get_cid (QMI_CLIENT (client))
+             );
+    }
+
+    if (output)
+        qmi_message_wds_start_network_output_unref (output);
+
+    dual_session_done ();
+}
+
+static void
+dual_session_job (QmicliJob *job,
+                  DualStackSession *session)
+{
+    QmiMessageWdsStartNetworkInput *input;
+
+    session->job = job;
+
+    input = start_network_input_create (start_network_dual_str);
+    qmi_message_wds_start_network_input_set_ip_family_preference (input, session->ip_family, NULL);
+
+    /* Each family is a request of its own, so one timing out doesn't
+     * abort the other */
+    session->request = qmicli_request_new (ctx->cancellable, qmicli_get_deadline ());
+
+    g_debug ("Asynchronously starting %s network...", session->name);
+    qmi_client_wds_start_network (session->client,
+                                  input,
+                                  qmicli_request_timeout (session->request, 45),
+                                  qmicli_request_get_cancellable (session->request),
+                                  (GAsyncReadyCallback)dual_start_network_ready,
+                                  session);
+    qmi_message_wds_start_network_input_unref (input);
+}
+
+static void
+dual_session_start (DualStackSession *session)
+{
+    qmicli_scheduler_submit (QMI_SERVICE_WDS,
+                             QMICLI_PRIORITY_INTERACTIVE,
+                             session->name,
+                             (QmicliJobFunc)dual_session_job,
+                             session);
+}
+
+static void
+dual_allocate_client_ready (QmiDevice *device,
+                            GAsyncResult *res)
+{
+    DualStackSession *session = &ctx->dual[1];
+    GError *error = NULL;
+    QmiClient *client;
+
+    client = qmi_device_allocate_client_finish (device, res, &error);
+    if (!client) {
+        session->json_result = json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't create client for the service",
+             "message", error->message
+              );
+        g_error_free (error);
+        dual_session_done ();
+        return;
+    }
+
+    session->client = QMI_CLIENT_WDS (client);
+    dual_session_start (session);
+}
+
 static void
 get_packet_service_status_ready (QmiClientWds *client,
                                  GAsyncResult *res)
 {
+    json_t *json_output;
     GError *error = NULL;
     QmiMessageWdsGetPacketServiceStatusOutput *output;
     QmiWdsConnectionStatus status;
 
     output = qmi_client_wds_get_packet_service_status_finish (client, res, &error);
     if (!output) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "operation failed",
              "message", error->message
-              ),json_print_flag));
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_wds_get_packet_service_status_output_get_result (output, &error)) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "couldn't get packet service status",
              "message", error->message
-              ),json_print_flag));
+              ));
         g_error_free (error);
         qmi_message_wds_get_packet_service_status_output_unref (output);
         shutdown (FALSE);
@@ -478,12 +974,14 @@ get_packet_service_status_ready (QmiClientWds *client,
         &status,
         NULL);
 
-    g_print ("%s\n", json_dumps(json_pack("{sbsssssb}",
+    json_output = json_pack("{sbsssssb}",
              "success", 1,
              "device", qmi_device_get_path_display (ctx->device),
              "connection status", qmi_wds_connection_status_get_string (status),
              "stopping", 0
-              ),json_print_flag));
+              );
+    qmicli_coalesce_json_add_age (json_output, res);
+    qmicli_output_json (json_output);
 
     qmi_message_wds_get_packet_service_status_output_unref (output);
     shutdown (TRUE);
@@ -491,32 +989,31 @@ get_packet_service_status_ready (QmiClientWds *client,
 
 static void
 get_packet_statistics_ready (QmiClientWds *client,
-                             GAsyncResult *res)
+                             GAsyncResult *res,
+                             gpointer user_data)
 {
     GError *error = NULL;
     QmiMessageWdsGetPacketStatisticsOutput *output;
-    guint32 val32;
-    guint64 val64;
     json_t *json_output;
 
     output = qmi_client_wds_get_packet_statistics_finish (client, res, &error);
     if (!output) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "operation failed",
              "message", error->message
-              ),json_print_flag));
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_wds_get_packet_statistics_output_get_result (output, &error)) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "couldn't get packet statistics",
              "message", error->message
-              ),json_print_flag));
+              ));
         g_error_free (error);
         qmi_message_wds_get_packet_statistics_output_unref (output);
         shutdown (FALSE);
@@ -529,102 +1026,11 @@ get_packet_statistics_ready (QmiClientWds *client,
              "connection statistics"
               );
 
-    if (qmi_message_wds_get_packet_statistics_output_get_tx_packets_ok (output, &val32, NULL) &&
-        val32 != 0xFFFFFFFF)
-        json_object_update(json_object_get(json_output,"connection statistics"),json_pack("{si}", 
-               "tx packets ok", val32
-               )); 
-        //g_print ("\tTX packets OK: %u\n", val32);
-    if (qmi_message_wds_get_packet_statistics_output_get_rx_packets_ok (output, &val32, NULL) &&
-        val32 != 0xFFFFFFFF)
-        json_object_update(json_object_get(json_output,"connection statistics"),json_pack("{si}", 
-               "rx packets ok", val32
-               )); 
-        //g_print ("\tRX packets OK: %u\n", val32);
-    if (qmi_message_wds_get_packet_statistics_output_get_tx_packets_error (output, &val32, NULL) &&
-        val32 != 0xFFFFFFFF)
-        json_object_update(json_object_get(json_output,"connection statistics"),json_pack("{si}", 
-               "tx packets error", val32
-               )); 
-        //g_print ("\tTX packets error: %u\n", val32);
-    if (qmi_message_wds_get_packet_statistics_output_get_rx_packets_error (output, &val32, NULL) &&
-        val32 != 0xFFFFFFFF)
-        json_object_update(json_object_get(json_output,"connection statistics"),json_pack("{si}", 
-               "rx packets error", val32
-               )); 
-        //g_print ("\tRX packets error: %u\n", val32);
-    if (qmi_message_wds_get_packet_statistics_output_get_tx_overflows (output, &val32, NULL) &&
-        val32 != 0xFFFFFFFF)
-        json_object_update(json_object_get(json_output,"connection statistics"),json_pack("{si}", 
-               "tx overflows", val32
-               )); 
-        //g_print ("\tTX overflows: %u\n", val32);
-    if (qmi_message_wds_get_packet_statistics_output_get_rx_overflows (output, &val32, NULL) &&
-        val32 != 0xFFFFFFFF)
-        json_object_update(json_object_get(json_output,"connection statistics"),json_pack("{si}", 
-               "rx overflows", val32
-               )); 
-        //g_print ("\tRX overflows: %u\n", val32);
-    if (qmi_message_wds_get_packet_statistics_output_get_tx_packets_dropped (output, &val32, NULL) &&
-        val32 != 0xFFFFFFFF)
-        json_object_update(json_object_get(json_output,"connection statistics"),json_pack("{si}", 
-               "tx packets dropped", val32
-               )); 
-        //g_print ("\tTX packets dropped: %u\n", val32);
-    if (qmi_message_wds_get_packet_statistics_output_get_rx_packets_dropped (output, &val32, NULL) &&
-        val32 != 0xFFFFFFFF)
-        json_object_update(json_object_get(json_output,"connection statistics"),json_pack("{si}", 
-               "rx packets dropped", val32
-               )); 
-        //g_print ("\tRX packets dropped: %u\n", val32);
-
-    /* Next code shifts uint64 values into two uint32 values. 
-       Jansson can only handle a int64 value. This is temporarty hack 
-       until Jansson (or another JSON library) has good uint64 support. */ 
-    
-    if (qmi_message_wds_get_packet_statistics_output_get_tx_bytes_ok (output, &val64, NULL)) {
-        /* break uint64_t low bytes out */
-        guint64 temp_low32 = ((val64 >> 32 ) << 32);
-        guint32 low32 = (guint32)(val64 - temp_low32);
-        json_object_update(json_object_get(json_output,"connection statistics"),json_pack("{sisi}", 
-               "tx bytes ok 32high", (guint32)(val64 >> 32),
-               "tx bytes ok 32low", low32
-               )); 
-        //g_print ("\tTX bytes OK: %" G_GUINT64_FORMAT "\n", val64);
-    }
-    if (qmi_message_wds_get_packet_statistics_output_get_rx_bytes_ok (output, &val64, NULL)) {
-        /* break uint64_t low bytes out */
-        guint64 temp_low32 = ((val64 >> 32 ) << 32);
-        guint32 low32 = (guint32)(val64 - temp_low32);
-        json_object_update(json_object_get(json_output,"connection statistics"),json_pack("{sisi}", 
-               "rx bytes ok 32high", (guint32)(val64 >> 32),
-               "rx bytes ok 32low", low32
-               )); 
-        //g_print ("\tRX bytes OK: %" G_GUINT64_FORMAT "\n", val64);
-    }
-    if (qmi_message_wds_get_packet_statistics_output_get_last_call_tx_bytes_ok (output, &val64, NULL)) {
-        /* break uint64_t low bytes out */
-        guint64 temp_low32 = ((val64 >> 32 ) << 32);
-        guint32 low32 = (guint32)(val64 - temp_low32);
-        json_object_update(json_object_get(json_output,"connection statistics"),json_pack("{sisi}", 
-               "last session tx bytes ok 32high", (guint32)(val64 >> 32),
-               "last session tx bytes ok 32low", low32
-               )); 
-        //g_print ("\tTX bytes OK (last): %" G_GUINT64_FORMAT "\n", val64);
-    }
-    if (qmi_message_wds_get_packet_statistics_output_get_last_call_rx_bytes_ok (output, &val64, NULL)) {
-        /* break uint64_t low bytes out */
-        guint64 temp_low32 = ((val64 >> 32 ) << 32);
-        guint32 low32 = (guint32)(val64 - temp_low32);
-        json_object_update(json_object_get(json_output,"connection statistics"),json_pack("{sisi}", 
-               "last session tx bytes ok 32high", (guint32)(val64 >> 32),
-               "last session tx bytes ok 32low", low32
-               )); 
-        //g_print ("\tRX bytes OK (last): %" G_GUINT64_FORMAT "\n", val64);
-    }
+    qmicli_json_wds_get_packet_statistics_output (output,
+                                                  json_object_get (json_output, "connection statistics"),
+                                                  (QmiWdsPacketStatisticsMaskFlag)GPOINTER_TO_UINT (user_data));
 
-    g_print ("%s\n", json_dumps(json_output,json_print_flag) ? : JSON_OUTPUT_ERROR);
-    g_free(json_output);
+    qmicli_output_json (json_output);
 
     qmi_message_wds_get_packet_statistics_output_unref (output);
     shutdown (TRUE);
@@ -640,11 +1046,11 @@ get_data_bearer_technology_ready (QmiClientWds *client,
 
     output = qmi_client_wds_get_data_bearer_technology_finish (client, res, &error);
     if (!output) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "operation failed",
              "message", error->message
-              ),json_print_flag));
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
@@ -668,7 +1074,7 @@ get_data_bearer_technology_ready (QmiClientWds *client,
                     output,
                     &last,
                     NULL))
-            json_object_update(json_output, json_pack("{s{siss}}",
+            qmicli_json_object_update_new (json_output, json_pack("{s{siss}}",
                     "last",
                           "data bearer technology id", last,
                           "data bearer technology ", qmi_wds_data_bearer_technology_get_string (last) ? : "(null)" 
@@ -680,8 +1086,7 @@ get_data_bearer_technology_ready (QmiClientWds *client,
 
         g_error_free (error);
 
-        g_print ("%s\n", json_dumps(json_output,json_print_flag) ? : JSON_OUTPUT_ERROR);
-        g_free(json_output);
+        qmicli_output_json (json_output);
         qmi_message_wds_get_data_bearer_technology_output_unref (output);
         shutdown (FALSE);
         return;
@@ -692,13 +1097,13 @@ get_data_bearer_technology_ready (QmiClientWds *client,
         &current,
         NULL);
 
-    g_print ("%s\n", json_dumps(json_pack("{sbsss{siss}}",
+    qmicli_output_json (json_pack("{sbsss{siss}}",
              "success", 1,
              "device", qmi_device_get_path_display (ctx->device),
              "current",
 			     "data bearer technology id", current,
                              "data bearer technology", qmi_wds_data_bearer_technology_get_string (current) ? : "(null)"
-              ),json_print_flag) ? : JSON_OUTPUT_ERROR);
+              ));
 
     qmi_message_wds_get_data_bearer_technology_output_unref (output);
     shutdown (TRUE);
@@ -723,14 +1128,14 @@ print_current_data_bearer_technology_results (const gchar *which,
         rat_string = qmi_wds_rat_3gpp_build_string_from_mask (rat_mask);
     }
 
-    g_print ("%s\n", json_dumps(json_pack("{sbsss{ssssss}}",
+    qmicli_output_json (json_pack("{sbsss{ssssss}}",
              "success", 1,
              "device", qmi_device_get_path_display (ctx->device) ? : "(null)",
              which,
 			     "network type", qmi_wds_network_type_get_string (network_type),
                              "radio access technology", VALIDATE_UNKNOWN (rat_string),
                              "service option", VALIDATE_UNKNOWN (rat_string)
-              ),json_print_flag) ? : JSON_OUTPUT_ERROR);
+              ));
     g_free (rat_string);
     g_free (so_string);
 }
@@ -747,11 +1152,11 @@ get_current_data_bearer_technology_ready (QmiClientWds *client,
 
     output = qmi_client_wds_get_current_data_bearer_technology_finish (client, res, &error);
     if (!output) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "operation failed",
              "message", error->message
-              ),json_print_flag));
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
@@ -761,11 +1166,11 @@ get_current_data_bearer_technology_ready (QmiClientWds *client,
 #define VALIDATE_UNKNOWN(str) (str ? str : "unknown")
 
     if (!qmi_message_wds_get_current_data_bearer_technology_output_get_result (output, &error)) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "couldn't get data bearer technology",
              "message", error->message
-              ),json_print_flag));
+              ));
 
         if (qmi_message_wds_get_current_data_bearer_technology_output_get_last (
                 output,
@@ -808,6 +1213,7 @@ typedef struct {
     guint i;
     GArray *profile_list;
     json_t *json_value;
+    json_t *profiles;
 } GetProfileListContext;
 
 static void get_next_profile_settings (GetProfileListContext *inner_ctx);
@@ -822,11 +1228,11 @@ get_profile_settings_ready (QmiClientWds *client,
 
     output = qmi_client_wds_get_profile_settings_finish (client, res, &error);
     if (!output) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "operation failed",
              "message", error->message
-              ),json_print_flag));
+              ));
         g_error_free (error);
     } else if (!qmi_message_wds_get_profile_settings_output_get_result (output, &error)) {
         QmiWdsDsProfileError ds_profile_error;
@@ -838,57 +1244,22 @@ get_profile_settings_ready (QmiClientWds *client,
                 output,
                 &ds_profile_error,
                 NULL)) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "couldn't get profile settings: ds profile error",
              "message", qmi_wds_ds_profile_error_get_string (ds_profile_error)
-              ),json_print_flag));
+              ));
         } else {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "couldn't get profile settings",
              "message", error->message
-              ),json_print_flag));
+              ));
         }
         g_error_free (error);
         qmi_message_wds_get_profile_settings_output_unref (output);
     } else {
-        const gchar *str;
-        QmiWdsPdpType pdp_type;
-        QmiWdsAuthentication auth;
-        gchar intstr[5];
-
-        g_snprintf(intstr,4,"%u", inner_ctx->i+1);
-
-        if (qmi_message_wds_get_profile_settings_output_get_apn_name (output, &str, NULL)) {
-            json_object_update(json_object_get(inner_ctx->json_value,intstr), json_pack("{ss}",
-                        "apn", VALIDATE_UNKNOWN (str)
-            ));
-        }
-        if (qmi_message_wds_get_profile_settings_output_get_pdp_type (output, &pdp_type, NULL)) {
-            json_object_update(json_object_get(inner_ctx->json_value,intstr), json_pack("{ss}",
-                        "pdp type", VALIDATE_UNKNOWN (qmi_wds_pdp_type_get_string (pdp_type))
-            ));
-        }
-        if (qmi_message_wds_get_profile_settings_output_get_username (output, &str, NULL)) {
-            json_object_update(json_object_get(inner_ctx->json_value,intstr), json_pack("{ss}",
-                        "username", VALIDATE_UNKNOWN (str)
-            ));
-        }
-        if (qmi_message_wds_get_profile_settings_output_get_password (output, &str, NULL)) {
-            json_object_update(json_object_get(inner_ctx->json_value,intstr), json_pack("{ss}",
-                        "password", VALIDATE_UNKNOWN (str)
-            ));
-        }
-        if (qmi_message_wds_get_profile_settings_output_get_authentication (output, &auth, NULL)) {
-            gchar *aux;
-
-            aux = qmi_wds_authentication_build_string_from_mask (auth);
-            json_object_update(json_object_get(inner_ctx->json_value,intstr), json_pack("{ss}",
-                        "auth", VALIDATE_UNKNOWN (aux)
-            ));
-            g_free (aux);
-        }
+        qmicli_json_wds_get_profile_settings_output (output, json_array_get (inner_ctx->profiles, inner_ctx->i));
         qmi_message_wds_get_profile_settings_output_unref (output);
     }
 
@@ -902,27 +1273,17 @@ get_next_profile_settings (GetProfileListContext *inner_ctx)
 {
     QmiMessageWdsGetProfileListOutputProfileListProfile *profile;
     QmiMessageWdsGetProfileSettingsInput *input;
-    gchar intstr[5];
 
     if (inner_ctx->i >= inner_ctx->profile_list->len) {
         /* All done */
+        qmicli_output_json (inner_ctx->json_value);
         g_array_unref (inner_ctx->profile_list);
         g_slice_free (GetProfileListContext, inner_ctx);
-        g_print ("%s\n", json_dumps(inner_ctx->json_value,json_print_flag) ? : JSON_OUTPUT_ERROR);
-        g_free(inner_ctx->json_value);
         shutdown (TRUE);
         return;
     }
 
     profile = &g_array_index (inner_ctx->profile_list, QmiMessageWdsGetProfileListOutputProfileListProfile, inner_ctx->i);
-    // load profile header info into JSON
-    g_snprintf(intstr,4,"%u", inner_ctx->i+1);
-    json_object_update(inner_ctx->json_value,json_pack("{s{ssss}}",
-             intstr,
-                   "name", VALIDATE_UNKNOWN (profile->profile_name),
-                   "type", VALIDATE_UNKNOWN (qmi_wds_profile_type_get_string (profile->profile_type))
-             ));
-
     input = qmi_message_wds_get_profile_settings_input_new ();
     qmi_message_wds_get_profile_settings_input_set_profile_id (
         input,
@@ -931,8 +1292,8 @@ get_next_profile_settings (GetProfileListContext *inner_ctx)
         NULL);
     qmi_client_wds_get_profile_settings (ctx->client,
                                          input,
-                                         3,
-                                         NULL,
+                                         qmicli_request_timeout (ctx->request, 3),
+                                         ctx->cancellable,
                                          (GAsyncReadyCallback)get_profile_settings_ready,
                                          inner_ctx);
     qmi_message_wds_get_profile_settings_input_unref (input);
@@ -946,14 +1307,15 @@ get_profile_list_ready (QmiClientWds *client,
     QmiMessageWdsGetProfileListOutput *output;
     GetProfileListContext *inner_ctx;
     GArray *profile_list = NULL;
+    guint i;
 
     output = qmi_client_wds_get_profile_list_finish (client, res, &error);
     if (!output) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "operation failed",
              "message", error->message
-              ),json_print_flag));
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
@@ -969,17 +1331,17 @@ get_profile_list_ready (QmiClientWds *client,
                 output,
                 &ds_profile_error,
                 NULL)) {
-            g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+            qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "couldn't get profile settings: ds profile error",
              "message", qmi_wds_ds_profile_error_get_string (ds_profile_error)
-              ),json_print_flag));
+              ));
         } else {
-            g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+            qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "couldn't get profile settings",
              "message", error->message
-              ),json_print_flag));
+              ));
         }
 
         g_error_free (error);
@@ -991,10 +1353,10 @@ get_profile_list_ready (QmiClientWds *client,
     qmi_message_wds_get_profile_list_output_get_profile_list (output, &profile_list, NULL);
 
     if (!profile_list || !profile_list->len) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "profile list empty"
-              ),json_print_flag));
+              ));
         qmi_message_wds_get_profile_list_output_unref (output);
         shutdown (TRUE);
         return;
@@ -1004,10 +1366,26 @@ get_profile_list_ready (QmiClientWds *client,
     inner_ctx = g_slice_new (GetProfileListContext);
     inner_ctx->profile_list = g_array_ref (profile_list);
     inner_ctx->i = 0;
-    inner_ctx->json_value = json_pack("{sbss}",
+    inner_ctx->json_value = json_pack("{sbsss[]}",
              "success", 1,
-             "device", qmi_device_get_path_display (ctx->device)
+             "device", qmi_device_get_path_display (ctx->device),
+             "profiles"
               );
+    inner_ctx->profiles = json_object_get (inner_ctx->json_value, "profiles");
+
+    /* One entry per profile, in list order; settings are filled in as they arrive */
+    for (i = 0; i < profile_list->len; i++) {
+        QmiMessageWdsGetProfileListOutputProfileListProfile *profile;
+
+        profile = &g_array_index (profile_list, QmiMessageWdsGetProfileListOutputProfileListProfile, i);
+        json_array_append_new (inner_ctx->profiles, json_pack("{sissss}",
+                 "index", (gint)profile->profile_index,
+                 "name", VALIDATE_UNKNOWN (profile->profile_name),
+                 "type", VALIDATE_UNKNOWN (qmi_wds_profile_type_get_string (profile->profile_type))
+                  ));
+    }
+    qmi_message_wds_get_profile_list_output_unref (output);
+
     get_next_profile_settings (inner_ctx);
 }
 
@@ -1017,18 +1395,15 @@ get_default_settings_ready (QmiClientWds *client,
 {
     QmiMessageWdsGetDefaultSettingsOutput *output;
     GError *error = NULL;
-    const gchar *str;
-    QmiWdsPdpType pdp_type;
-    QmiWdsAuthentication auth;
     json_t *json_output;
 
     output = qmi_client_wds_get_default_settings_finish (client, res, &error);
     if (!output) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "operation failed",
              "message", error->message
-              ),json_print_flag));
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
@@ -1044,17 +1419,17 @@ get_default_settings_ready (QmiClientWds *client,
                 output,
                 &ds_profile_error,
                 NULL)) {
-            g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+            qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "couldn't get default settings: ds profile error",
              "message", qmi_wds_ds_profile_error_get_string (ds_profile_error)
-              ),json_print_flag));
+              ));
         } else {
-            g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+            qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "couldn't get default settings",
              "message", error->message
-              ),json_print_flag));
+              ));
         }
         g_error_free (error);
         qmi_message_wds_get_default_settings_output_unref (output);
@@ -1062,45 +1437,15 @@ get_default_settings_ready (QmiClientWds *client,
         return;
     }
 
-    //g_print ("Default settings retrieved:\n");
     json_output = json_pack("{sbsss{}}",
              "success", 1,
              "device", qmi_device_get_path_display (ctx->device),
              "default"
               );
 
-    if (qmi_message_wds_get_default_settings_output_get_apn_name (output, &str, NULL))
-            json_object_update(json_object_get(json_output,"default"), json_pack("{ss}",
-                        "apn", VALIDATE_UNKNOWN (str)
-            ));
-        //g_print ("\tAPN: '%s'\n", str);
-    if (qmi_message_wds_get_default_settings_output_get_pdp_type (output, &pdp_type, NULL))
-            json_object_update(json_object_get(json_output,"default"), json_pack("{ss}",
-                        "pdp type", VALIDATE_UNKNOWN (qmi_wds_pdp_type_get_string (pdp_type))
-            ));
-        //g_print ("\tPDP type: '%s'\n", qmi_wds_pdp_type_get_string (pdp_type));
-    if (qmi_message_wds_get_default_settings_output_get_username (output, &str, NULL))
-            json_object_update(json_object_get(json_output,"default"), json_pack("{ss}",
-                        "username", VALIDATE_UNKNOWN (str)
-            ));
-        //g_print ("\tUsername: '%s'\n", str);
-    if (qmi_message_wds_get_default_settings_output_get_password (output, &str, NULL))
-            json_object_update(json_object_get(json_output,"default"), json_pack("{ss}",
-                        "password", VALIDATE_UNKNOWN (str)
-            ));
-        //g_print ("\tPassword: '%s'\n", str);
-    if (qmi_message_wds_get_default_settings_output_get_authentication (output, &auth, NULL)) {
-        gchar *aux;
-
-        aux = qmi_wds_authentication_build_string_from_mask (auth);
-        json_object_update(json_object_get(json_output,"default"), json_pack("{ss}",
-                   "auth", VALIDATE_UNKNOWN (aux)
-        ));
-        g_free (aux);
-    }
+    qmicli_json_wds_get_default_settings_output (output, json_object_get (json_output, "default"));
 
-    g_print ("%s\n", json_dumps(json_output,json_print_flag) ? : JSON_OUTPUT_ERROR);
-    g_free(json_output);
+    qmicli_output_json (json_output);
 
     qmi_message_wds_get_default_settings_output_unref (output);
     shutdown (TRUE);
@@ -1115,32 +1460,32 @@ reset_ready (QmiClientWds *client,
 
     output = qmi_client_wds_reset_finish (client, res, &error);
     if (!output) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "operation failed",
              "message", error->message
-              ),json_print_flag));
+              ));
         g_error_free (error);
         shutdown (FALSE);
         return;
     }
 
     if (!qmi_message_wds_reset_output_get_result (output, &error)) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "couldn't reset the wds service",
              "message", error->message
-              ),json_print_flag));
+              ));
         g_error_free (error);
         qmi_message_wds_reset_output_unref (output);
         shutdown (FALSE);
         return;
     }
 
-    g_print ("%s\n", json_dumps(json_pack("{sbss}",
+    qmicli_output_json (json_pack("{sbss}",
              "success", 1,
              "message", "successfully performed wds service reset"
-              ),json_print_flag));
+              ));
 
     qmi_message_wds_reset_output_unref (output);
     shutdown (TRUE);
@@ -1162,61 +1507,61 @@ qmicli_wds_run (QmiDevice *device,
     ctx = g_slice_new (Context);
     ctx->device = g_object_ref (device);
     ctx->client = g_object_ref (client);
-    ctx->cancellable = g_object_ref (cancellable);
+    ctx->request = qmicli_request_new (cancellable, qmicli_get_deadline ());
+    ctx->cancellable = g_object_ref (qmicli_request_get_cancellable (ctx->request));
     ctx->network_started_id = 0;
     ctx->packet_status_timeout_id = 0;
+    ctx->start_network_input = NULL;
+    ctx->connected = FALSE;
+    ctx->reconnect_pending = FALSE;
+    ctx->reconnect_timeout_id = 0;
+    ctx->reconnect_attempts = 0;
+    ctx->disconnected_timer = NULL;
+    memset (ctx->dual, 0, sizeof (ctx->dual));
+    ctx->dual_pending = 0;
+    ctx->dual_success = FALSE;
 
     /* Request to start network? */
     if (start_network_str) {
-        QmiMessageWdsStartNetworkInput *input = NULL;
-
-        /* Use the input string as APN */
-        if (start_network_str[0]) {
-            gchar **split;
-
-            split = g_strsplit (start_network_str, ",", 0);
-
-            input = qmi_message_wds_start_network_input_new ();
-            qmi_message_wds_start_network_input_set_apn (input, split[0], NULL);
-
-            if (split[1]) {
-                QmiWdsAuthentication qmiwdsauth;
-
-                /* Use authentication method */
-                if (g_ascii_strcasecmp (split[1], "PAP") == 0) {
-                    qmiwdsauth = QMI_WDS_AUTHENTICATION_PAP;
-                } else if (g_ascii_strcasecmp (split[1], "CHAP") == 0) {
-                    qmiwdsauth = QMI_WDS_AUTHENTICATION_CHAP;
-                } else if (g_ascii_strcasecmp (split[1], "BOTH") == 0) {
-                    qmiwdsauth = (QMI_WDS_AUTHENTICATION_PAP | QMI_WDS_AUTHENTICATION_CHAP);
-                } else {
-                    qmiwdsauth = QMI_WDS_AUTHENTICATION_NONE;
-                }
-
-                qmi_message_wds_start_network_input_set_authentication_preference (input, qmiwdsauth, NULL);
-
-                /* Username */
-                if (split[2] && strlen (split[2])) {
-                    qmi_message_wds_start_network_input_set_username (input, split[2], NULL);
-
-                    /* Password */
-                    if (split[3] && strlen (split[3])) {
-                        qmi_message_wds_start_network_input_set_password (input, split[3], NULL);
-                    }
-                }
-            }
-            g_strfreev (split);
-        }
+        QmiMessageWdsStartNetworkInput *input;
+
+        input = start_network_input_create (start_network_str);
+
+        /* Reconnections reuse the same APN and authentication settings */
+        if (follow_network_reconnect_flag)
+            ctx->start_network_input = qmi_message_wds_start_network_input_ref (input);
 
         g_debug ("Asynchronously starting network...");
         qmi_client_wds_start_network (ctx->client,
                                       input,
-                                      45,
+                                      qmicli_request_timeout (ctx->request, 45),
                                       ctx->cancellable,
                                       (GAsyncReadyCallback)start_network_ready,
                                       NULL);
-        if (input)
-            qmi_message_wds_start_network_input_unref (input);
+        qmi_message_wds_start_network_input_unref (input);
+        return;
+    }
+
+    /* Request to start dual-stack network? */
+    if (start_network_dual_str) {
+        ctx->dual[0].name = "ipv4";
+        ctx->dual[0].ip_family = QMI_WDS_IP_FAMILY_IPV4;
+        ctx->dual[0].client = g_object_ref (ctx->client);
+        ctx->dual[1].name = "ipv6";
+        ctx->dual[1].ip_family = QMI_WDS_IP_FAMILY_IPV6;
+        ctx->dual_pending = 2;
+
+        /* IPv4 goes on the client we already have while the IPv6 one is
+         * being allocated */
+        g_debug ("Asynchronously allocating second WDS client...");
+        qmi_device_allocate_client (ctx->device,
+                                    QMI_SERVICE_WDS,
+                                    QMI_CID_NONE,
+                                    qmicli_request_timeout (ctx->request, 10),
+                                    ctx->cancellable,
+                                    (GAsyncReadyCallback)dual_allocate_client_ready,
+                                    NULL);
+        dual_session_start (&ctx->dual[0]);
         return;
     }
 
@@ -1227,11 +1572,11 @@ qmicli_wds_run (QmiDevice *device,
         packet_data_handle = strtoul (stop_network_str, NULL, 10);
         if (!packet_data_handle ||
             packet_data_handle > G_MAXUINT32) {
-            g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+            qmicli_output_json (json_pack("{sbssss}",
                         "success", 0,
                         "error", "invalid packet data handle given",
                         "message", stop_network_str ? : "(null)"
-                        ),json_print_flag));
+                        ));
             shutdown (FALSE);
             return;
         }
@@ -1244,41 +1589,44 @@ qmicli_wds_run (QmiDevice *device,
     /* Request to get packet service status? */
     if (get_packet_service_status_flag) {
         g_debug ("Asynchronously getting packet service status...");
-        qmi_client_wds_get_packet_service_status (ctx->client,
-                                                  NULL,
-                                                  10,
-                                                  ctx->cancellable,
-                                                  (GAsyncReadyCallback)get_packet_service_status_ready,
-                                                  NULL);
+        qmicli_coalesce_call (&get_packet_service_status_message,
+                              G_OBJECT (ctx->client),
+                              NULL,
+                              NULL,
+                              qmicli_request_timeout (ctx->request, 10),
+                              ctx->cancellable,
+                              (GAsyncReadyCallback)get_packet_service_status_ready,
+                              NULL);
         return;
     }
 
     /* Request to get packet statistics? */
     if (get_packet_statistics_flag) {
         QmiMessageWdsGetPacketStatisticsInput *input;
+        QmiWdsPacketStatisticsMaskFlag mask;
+
+        if (!qmicli_read_packet_statistics_mask_from_string (get_packet_statistics_str, &mask)) {
+            qmicli_output_json (json_pack("{sbss}",
+                 "success", 0,
+                 "error", "failed to parse packet statistics counters"
+                  ));
+            shutdown (FALSE);
+            return;
+        }
 
         input = qmi_message_wds_get_packet_statistics_input_new ();
         qmi_message_wds_get_packet_statistics_input_set_mask (
             input,
-            (QMI_WDS_PACKET_STATISTICS_MASK_FLAG_TX_PACKETS_OK      |
-             QMI_WDS_PACKET_STATISTICS_MASK_FLAG_RX_PACKETS_OK      |
-             QMI_WDS_PACKET_STATISTICS_MASK_FLAG_TX_PACKETS_ERROR   |
-             QMI_WDS_PACKET_STATISTICS_MASK_FLAG_RX_PACKETS_ERROR   |
-             QMI_WDS_PACKET_STATISTICS_MASK_FLAG_TX_OVERFLOWS       |
-             QMI_WDS_PACKET_STATISTICS_MASK_FLAG_RX_OVERFLOWS       |
-             QMI_WDS_PACKET_STATISTICS_MASK_FLAG_TX_BYTES_OK        |
-             QMI_WDS_PACKET_STATISTICS_MASK_FLAG_RX_BYTES_OK        |
-             QMI_WDS_PACKET_STATISTICS_MASK_FLAG_TX_PACKETS_DROPPED |
-             QMI_WDS_PACKET_STATISTICS_MASK_FLAG_RX_PACKETS_DROPPED),
+            mask,
             NULL);
 
         g_debug ("Asynchronously getting packet statistics...");
         qmi_client_wds_get_packet_statistics (ctx->client,
                                               input,
-                                              10,
+                                              qmicli_request_timeout (ctx->request, 10),
                                               ctx->cancellable,
                                               (GAsyncReadyCallback)get_packet_statistics_ready,
-                                              NULL);
+                                              GUINT_TO_POINTER (mask));
         qmi_message_wds_get_packet_statistics_input_unref (input);
         return;
     }
@@ -1288,7 +1636,7 @@ qmicli_wds_run (QmiDevice *device,
         g_debug ("Asynchronously getting data bearer technology...");
         qmi_client_wds_get_data_bearer_technology (ctx->client,
                                                    NULL,
-                                                   10,
+                                                   qmicli_request_timeout (ctx->request, 10),
                                                    ctx->cancellable,
                                                    (GAsyncReadyCallback)get_data_bearer_technology_ready,
                                                    NULL);
@@ -1300,7 +1648,7 @@ qmicli_wds_run (QmiDevice *device,
         g_debug ("Asynchronously getting current data bearer technology...");
         qmi_client_wds_get_current_data_bearer_technology (ctx->client,
                                                            NULL,
-                                                           10,
+                                                           qmicli_request_timeout (ctx->request, 10),
                                                            ctx->cancellable,
                                                            (GAsyncReadyCallback)get_current_data_bearer_technology_ready,
                                                            NULL);
@@ -1317,11 +1665,11 @@ qmicli_wds_run (QmiDevice *device,
         else if (g_str_equal (get_profile_list_str, "3gpp2"))
             qmi_message_wds_get_profile_list_input_set_profile_type (input, QMI_WDS_PROFILE_TYPE_3GPP2, NULL);
         else {
-            g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+            qmicli_output_json (json_pack("{sbssss}",
                  "success", 0,
                  "error", "invalid profile type, expected '3gpp' or '3gpp2'",
                  "message", get_profile_list_str
-                 ),json_print_flag));
+                 ));
             shutdown (FALSE);
             return;
         }
@@ -1329,7 +1677,7 @@ qmicli_wds_run (QmiDevice *device,
         g_debug ("Asynchronously get profile list...");
         qmi_client_wds_get_profile_list (ctx->client,
                                          input,
-                                         10,
+                                         qmicli_request_timeout (ctx->request, 10),
                                          ctx->cancellable,
                                          (GAsyncReadyCallback)get_profile_list_ready,
                                          NULL);
@@ -1347,11 +1695,11 @@ qmicli_wds_run (QmiDevice *device,
         else if (g_str_equal (get_default_settings_str, "3gpp2"))
             qmi_message_wds_get_default_settings_input_set_profile_type (input, QMI_WDS_PROFILE_TYPE_3GPP2, NULL);
         else {
-            g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+            qmicli_output_json (json_pack("{sbssss}",
                  "success", 0,
                  "error", "invalid default type, expected '3gpp' or '3gpp2'",
                  "message", get_default_settings_str
-                 ),json_print_flag));
+                 ));
             shutdown (FALSE);
             return;
         }
@@ -1359,7 +1707,7 @@ qmicli_wds_run (QmiDevice *device,
         g_debug ("Asynchronously get default settings...");
         qmi_client_wds_get_default_settings (ctx->client,
                                              input,
-                                             10,
+                                             qmicli_request_timeout (ctx->request, 10),
                                              ctx->cancellable,
                                              (GAsyncReadyCallback)get_default_settings_ready,
                                              NULL);
@@ -1372,7 +1720,7 @@ qmicli_wds_run (QmiDevice *device,
         g_debug ("Asynchronously resetting WDS service...");
         qmi_client_wds_reset (ctx->client,
                               NULL,
-                              10,
+                              qmicli_request_timeout (ctx->request, 10),
                               ctx->cancellable,
                               (GAsyncReadyCallback)reset_ready,
                               NULL);
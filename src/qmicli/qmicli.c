@@ -33,6 +33,7 @@
 
 #include "qmicli.h"
 #include "qmicli-helpers.h"
+#include "qmicli-json-generated.h"
 
 #include <jansson.h>
 
@@ -42,6 +43,8 @@
 /* Globals */
 static GMainLoop *loop;
 static GCancellable *cancellable;
+static QmicliRequest *device_request;
+static gint64 deadline;
 static QmiDevice *device;
 static QmiClient *client;
 static QmiService service;
@@ -57,12 +60,26 @@ static gchar *device_open_net_str;
 static gboolean device_open_proxy_flag;
 static gchar *client_cid_str;
 static gboolean client_no_release_cid_flag;
+static gboolean client_cid_registry_flag;
+static gboolean client_cid_from_registry;
+static gboolean client_cid_registry_rejected;
+static gboolean version_info_deferred;
+static gboolean version_info_wait;
+static gboolean version_info_rejected;
+static gboolean client_waiting;
+static gboolean client_running;
 static gboolean verbose_flag;
 static gboolean json_flag;
+static gchar *fields_str;
+static QmicliFields *fields;
 size_t json_print_flag = JSON_PRESERVE_ORDER + JSON_INDENT(4);
 const char *JSON_OUTPUT_ERROR = "{\n    \"success\": false,\n    \"error\": \"internal error: unable to build json object\"\n}";
 static gboolean silent_flag;
 static gboolean version_flag;
+static gint timeout_secs;
+static gint monitor_diff;
+static gchar *record_str;
+static gchar *replay_str;
 
 static GOptionEntry main_entries[] = {
     { "device", 'd', 0, G_OPTION_ARG_STRING, &device_str,
@@ -101,10 +118,34 @@ static GOptionEntry main_entries[] = {
       "Do not release the CID when exiting",
       NULL
     },
+    { "client-cid-registry", 0, 0, G_OPTION_ARG_NONE, &client_cid_registry_flag,
+      "Reuse a CID kept in the per-device registry under the runtime dir, and keep the CID there when exiting",
+      NULL
+    },
     { "json", 'j', 0, G_OPTION_ARG_NONE, &json_flag,
       "Attempt to output COMPACT JSON for standard messages and errors",
       NULL
     },
+    { "timeout", 0, 0, G_OPTION_ARG_INT, &timeout_secs,
+      "Give up on the requested action after this many seconds, including device open",
+      "[SECONDS]"
+    },
+    { "fields", 0, 0, G_OPTION_ARG_STRING, &fields_str,
+      "Only output the given keys, with '_' in place of spaces (e.g. 'serving_system.registration_state,signal_strength')",
+      "[path,path,...]"
+    },
+    { "record", 0, 0, G_OPTION_ARG_FILENAME, &record_str,
+      "Write every QMI message exchanged with the device to FILE",
+      "[FILE]"
+    },
+    { "replay", 0, 0, G_OPTION_ARG_FILENAME, &replay_str,
+      "Answer requests with the messages recorded in FILE instead of using a device",
+      "[FILE]"
+    },
+    { "monitor-diff", 0, 0, G_OPTION_ARG_INT, &monitor_diff,
+      "Print monitor lines as JSON merge patches (RFC 7386) against the previous one, with a full line every N",
+      "[N]"
+    },
     { "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose_flag,
       "Run action with verbose logs, including the debug ones",
       NULL
@@ -197,13 +238,13 @@ log_handler (const gchar *log_domain,
 static void
 print_version_and_exit (void)
 {
-    g_print ("%s\n", json_dumps(json_pack("{sbssssssss}",
+    qmicli_output_json (json_pack("{sbssssssss}",
             "success", 1,
             "program_name", PROGRAM_NAME,
             "program_version", PROGRAM_VERSION,
             "copyright", "Copyright (2012) Aleksander Morgado\n",
             "license", "License GPLv2+: GNU GPL version 2 or later <http://gnu.org/licenses/gpl-2.0.html>. This is free software: you are free to change and redistribute it. There is NO WARRANTY, to the extent permitted by law."
-             ),json_print_flag));
+             ));
     exit (EXIT_SUCCESS);
 }
 
@@ -220,10 +261,10 @@ generic_options_enabled (void)
                  get_service_version_info_flag);
 
     if (n_actions > 1) {
-    g_print ("%s\n", json_dumps(json_pack("{sbss}",
+    qmicli_output_json (json_pack("{sbss}",
             "success", 0,
             "error", "too many generic actions requested"
-             ),json_print_flag));
+             ));
         exit (EXIT_FAILURE);
     }
 
@@ -231,6 +272,23 @@ generic_options_enabled (void)
     return !!n_actions;
 }
 
+/*****************************************************************************/
+/* Startup time, up to the first QMI request; see test/bench-startup.sh */
+
+static GTimer *startup_timer;
+
+static void
+startup_timer_stop (void)
+{
+    if (!startup_timer)
+        return;
+
+    g_debug ("Startup took %.3f ms until the first request",
+             g_timer_elapsed (startup_timer, NULL) * 1000.0);
+    g_timer_destroy (startup_timer);
+    startup_timer = NULL;
+}
+
 /*****************************************************************************/
 /* Running asynchronously */
 
@@ -241,11 +299,11 @@ release_client_ready (QmiDevice *dev,
     GError *error = NULL;
 
     if (!qmi_device_release_client_finish (dev, res, &error)) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "couldn't release client",
              "message", error->message
-              ),json_print_flag));
+              ));
         g_error_free (error);
     } else
         g_debug ("Client released");
@@ -253,13 +311,28 @@ release_client_ready (QmiDevice *dev,
     g_main_loop_quit (loop);
 }
 
+gint64
+qmicli_get_deadline (void)
+{
+    return deadline;
+}
+
+QmiDeviceReleaseClientFlags
+qmicli_release_client_flags (void)
+{
+    return (client_no_release_cid_flag ?
+            QMI_DEVICE_RELEASE_CLIENT_FLAGS_NONE :
+            QMI_DEVICE_RELEASE_CLIENT_FLAGS_RELEASE_CID);
+}
+
 void
 qmicli_async_operation_done (gboolean reported_operation_status)
 {
-    QmiDeviceReleaseClientFlags flags = QMI_DEVICE_RELEASE_CLIENT_FLAGS_NONE;
+    QmiDeviceReleaseClientFlags flags;
+    GError *error = NULL;
 
     /* Keep the result of the operation */
-    operation_status = reported_operation_status;
+    operation_status = reported_operation_status && !version_info_rejected;
 
     if (cancellable) {
         g_object_unref (cancellable);
@@ -272,9 +345,25 @@ qmicli_async_operation_done (gboolean reported_operation_status)
         return;
     }
 
-    if (!client_no_release_cid_flag)
-        flags |= QMI_DEVICE_RELEASE_CLIENT_FLAGS_RELEASE_CID;
-    else
+    flags = qmicli_release_client_flags ();
+
+    /* Keep the CID for later invocations; reused ones were checked already,
+     * so a failed action doesn't mean a bad CID */
+    if (client_cid_registry_flag) {
+        gchar *registry_path;
+
+        registry_path = qmicli_cid_registry_get_path (qmi_device_get_path (device));
+        if (qmicli_cid_registry_put (registry_path,
+                                     qmi_service_get_string (service),
+                                     qmi_client_get_cid (client),
+                                     &error)) {
+            flags = QMI_DEVICE_RELEASE_CLIENT_FLAGS_NONE;
+        } else {
+            g_debug ("%s", error->message);
+            g_clear_error (&error);
+        }
+        g_free (registry_path);
+    } else if (client_no_release_cid_flag)
         g_print ("[%s] Client ID not released:\n"
                  "\tService: '%s'\n"
                  "\t    CID: '%u'\n",
@@ -292,22 +381,8 @@ qmicli_async_operation_done (gboolean reported_operation_status)
 }
 
 static void
-allocate_client_ready (QmiDevice *dev,
-                       GAsyncResult *res)
+client_run (QmiDevice *dev)
 {
-    GError *error = NULL;
-
-    client = qmi_device_allocate_client_finish (dev, res, &error);
-    if (!client) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
-             "success", 0,
-             "error", "couldn't create client for the service",
-             "message", error->message,
-             "service", qmi_service_get_string (service)
-              ),json_print_flag));
-        exit (EXIT_FAILURE);
-    }
-
     /* Run the service-specific action */
     switch (service) {
     case QMI_SERVICE_DMS:
@@ -330,6 +405,162 @@ allocate_client_ready (QmiDevice *dev,
     }
 }
 
+/* The action may have to wait for the service version info */
+static void
+client_ready (QmiDevice *dev)
+{
+    if (version_info_wait) {
+        g_debug ("Waiting for service version info...");
+        client_waiting = TRUE;
+        return;
+    }
+
+    client_running = TRUE;
+    client_run (dev);
+}
+
+static void device_allocate_client (QmiDevice *dev);
+
+/* A CID from the registry may have been dropped by the modem since, e.g.
+ * after a reset. One cheap read on it tells, before the action runs. */
+static const QmicliCoalescedMessage registry_cid_probes[] = {
+    QMICLI_COALESCED_MESSAGE (dms, get_ids, 0),
+    QMICLI_COALESCED_MESSAGE (nas, get_signal_strength, 0),
+    QMICLI_COALESCED_MESSAGE (wds, get_packet_service_status, 0),
+    QMICLI_COALESCED_MESSAGE (pbm, get_all_capabilities, 0),
+    QMICLI_COALESCED_MESSAGE (uim, get_card_status, 0),
+};
+
+static const QmicliCoalescedMessage *
+registry_cid_probe_for_service (void)
+{
+    switch (service) {
+    case QMI_SERVICE_DMS: return &registry_cid_probes[0];
+    case QMI_SERVICE_NAS: return &registry_cid_probes[1];
+    case QMI_SERVICE_WDS: return &registry_cid_probes[2];
+    case QMI_SERVICE_PBM: return &registry_cid_probes[3];
+    case QMI_SERVICE_UIM: return &registry_cid_probes[4];
+    default:
+        g_assert_not_reached ();
+    }
+}
+
+static void
+rejected_client_released (QmiDevice *dev,
+                          GAsyncResult *res)
+{
+    /* The modem may well not know the CID anymore */
+    qmi_device_release_client_finish (dev, res, NULL);
+    if (version_info_rejected) {
+        qmicli_async_operation_done (FALSE);
+        return;
+    }
+    device_allocate_client (dev);
+}
+
+static void
+registry_cid_probe_ready (GObject *source,
+                          GAsyncResult *res,
+                          const QmicliCoalescedMessage *probe)
+{
+    GError *error = NULL;
+    gpointer output;
+
+    output = probe->finish (source, res, &error);
+    if (version_info_rejected) {
+        if (output)
+            probe->output_unref (output);
+        g_clear_error (&error);
+        qmicli_async_operation_done (FALSE);
+        return;
+    }
+
+    if (output) {
+        /* Any other protocol error still means the CID was accepted */
+        probe->get_result (output, &error);
+        probe->output_unref (output);
+    }
+
+    if (error &&
+        (g_error_matches (error, QMI_PROTOCOL_ERROR, QMI_PROTOCOL_ERROR_INVALID_CLIENT_ID) ||
+         error->domain == QMI_CORE_ERROR)) {
+        g_debug ("CID '%u' from registry rejected (%s); allocating a new one",
+                 qmi_client_get_cid (client), error->message);
+        g_error_free (error);
+
+        client_cid_from_registry = FALSE;
+        client_cid_registry_rejected = TRUE;
+        qmi_device_release_client (device,
+                                   client,
+                                   QMI_DEVICE_RELEASE_CLIENT_FLAGS_RELEASE_CID,
+                                   qmicli_request_timeout (device_request, 10),
+                                   qmicli_request_get_cancellable (device_request),
+                                   (GAsyncReadyCallback)rejected_client_released,
+                                   NULL);
+        g_object_unref (client);
+        client = NULL;
+        return;
+    }
+
+    /* Interrupted, or past the deadline */
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't check client ID from registry",
+             "message", error->message
+              ));
+        g_error_free (error);
+        qmicli_async_operation_done (FALSE);
+        return;
+    }
+
+    if (error)
+        g_error_free (error);
+    client_ready (device);
+}
+
+static void
+allocate_client_ready (QmiDevice *dev,
+                       GAsyncResult *res)
+{
+    GError *error = NULL;
+
+    client = qmi_device_allocate_client_finish (dev, res, &error);
+
+    /* Releases the client, if it was allocated anyway */
+    if (version_info_rejected) {
+        g_clear_error (&error);
+        qmicli_async_operation_done (FALSE);
+        return;
+    }
+
+    if (!client) {
+        qmicli_output_json (json_pack("{sbssss}",
+             "success", 0,
+             "error", "couldn't create client for the service",
+             "message", error->message,
+             "service", qmi_service_get_string (service)
+              ));
+        exit (EXIT_FAILURE);
+    }
+
+    if (client_cid_from_registry) {
+        const QmicliCoalescedMessage *probe;
+
+        probe = registry_cid_probe_for_service ();
+        g_debug ("Checking CID '%u' from registry...", qmi_client_get_cid (client));
+        probe->method (client,
+                       NULL,
+                       qmicli_request_timeout (device_request, 5),
+                       qmicli_request_get_cancellable (device_request),
+                       (GAsyncReadyCallback)registry_cid_probe_ready,
+                       (gpointer)probe);
+        return;
+    }
+
+    client_ready (dev);
+}
+
 static void
 device_allocate_client (QmiDevice *dev)
 {
@@ -340,16 +571,34 @@ device_allocate_client (QmiDevice *dev)
 
         cid32 = atoi (client_cid_str);
         if (!cid32 || cid32 > G_MAXUINT8) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "invalid cid given",
              "message", client_cid_str
-              ),json_print_flag));
+              ));
             exit (EXIT_FAILURE);
         }
 
         cid = (guint8)cid32;
         g_debug ("Reusing CID '%u'", cid);
+    } else if (client_cid_registry_flag && !client_cid_registry_rejected) {
+        GError *error = NULL;
+        gchar *registry_path;
+
+        /* Any failure here just means a fresh allocation */
+        registry_path = qmicli_cid_registry_get_path (qmi_device_get_path (dev));
+        if (!qmicli_cid_registry_take (registry_path,
+                                       qmi_service_get_string (service),
+                                       &cid,
+                                       &error)) {
+            g_debug ("%s", error->message);
+            g_error_free (error);
+            cid = QMI_CID_NONE;
+        } else if (cid != QMI_CID_NONE) {
+            client_cid_from_registry = TRUE;
+            g_debug ("Reusing CID '%u' from registry", cid);
+        }
+        g_free (registry_path);
     }
 
     /* As soon as we get the QmiDevice, create a client for the requested
@@ -357,8 +606,8 @@ device_allocate_client (QmiDevice *dev)
     qmi_device_allocate_client (dev,
                                 service,
                                 cid,
-                                10,
-                                cancellable,
+                                qmicli_request_timeout (device_request, 10),
+                                qmicli_request_get_cancellable (device_request),
                                 (GAsyncReadyCallback)allocate_client_ready,
                                 NULL);
 }
@@ -371,11 +620,11 @@ set_instance_id_ready (QmiDevice *dev,
     guint16 link_id;
 
     if (!qmi_device_set_instance_id_finish (dev, res, &link_id, &error)) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "couldn't set instance id",
              "message", error->message
-              ),json_print_flag));
+              ));
         exit (EXIT_FAILURE);
     }
 
@@ -398,19 +647,19 @@ device_set_instance_id (QmiDevice *dev)
     else {
         instance_id = atoi (device_set_instance_id_str);
         if (instance_id == 0) {
-            g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+            qmicli_output_json (json_pack("{sbssss}",
                "success", 0,
                "error", "invalid instance id given",
                "message", device_set_instance_id_str
-               ),json_print_flag));
+               ));
             exit (EXIT_FAILURE);
         } else if (instance_id < 0 || instance_id > G_MAXUINT8) {
-            g_print ("%s\n", json_dumps(json_pack("{sbsssssi}",
+            qmicli_output_json (json_pack("{sbsssssi}",
                         "success", 0,
                         "error", "given instance id is out of range",
                         "message", device_set_instance_id_str,
                         "max", G_MAXUINT8
-                        ),json_print_flag));
+                        ));
             exit (EXIT_FAILURE);
         }
     }
@@ -418,12 +667,140 @@ device_set_instance_id (QmiDevice *dev)
     g_debug ("Setting instance ID '%d'...", instance_id);
     qmi_device_set_instance_id (dev,
                                 (guint8)instance_id,
-                                10,
-                                cancellable,
+                                qmicli_request_timeout (device_request, 10),
+                                qmicli_request_get_cancellable (device_request),
                                 (GAsyncReadyCallback)set_instance_id_ready,
                                 NULL);
 }
 
+static void
+version_info_cache_update (QmiDevice *dev,
+                           GArray *services)
+{
+    GError *error = NULL;
+    gchar *cache_path;
+
+    /* The device path is just a stand-in when recording or replaying */
+    if (record_str || replay_str)
+        return;
+
+    cache_path = qmicli_version_info_cache_get_path (qmi_device_get_path (dev));
+    if (!qmicli_version_info_cache_save (cache_path, services, &error)) {
+        g_debug ("couldn't update service version info cache: %s", error->message);
+        g_error_free (error);
+    }
+    g_free (cache_path);
+}
+
+static gboolean
+version_info_has_service (GArray *services,
+                          QmiService requested)
+{
+    guint i;
+
+    for (i = 0; i < services->len; i++) {
+        QmiDeviceServiceVersionInfo *info;
+
+        info = &g_array_index (services, QmiDeviceServiceVersionInfo, i);
+        if (info->service == requested) {
+            g_debug ("Service '%s' version %u.%u",
+                     qmi_service_get_string (requested),
+                     info->major_version,
+                     info->minor_version);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/* Same as opening with QMI_DEVICE_OPEN_FLAGS_VERSION_INFO would have done,
+ * but the client allocation, or even the action, may be under way already:
+ * whatever is pending ends through its own callback, and an action running
+ * through its cancellation */
+static void
+version_info_reject (void)
+{
+    qmicli_output_json (json_pack("{sbssss}",
+         "success", 0,
+         "error", "service not supported by the device",
+         "service", qmi_service_get_string (service)
+          ));
+    version_info_rejected = TRUE;
+    operation_status = FALSE;
+
+    g_cancellable_cancel (qmicli_request_get_cancellable (device_request));
+    if (client_running)
+        g_cancellable_cancel (cancellable);
+    else if (client_waiting) {
+        client_waiting = FALSE;
+        qmicli_async_operation_done (FALSE);
+    }
+}
+
+static void
+version_info_done (QmiDevice *dev)
+{
+    version_info_wait = FALSE;
+    if (client_waiting) {
+        client_waiting = FALSE;
+        client_ready (dev);
+    }
+}
+
+static void
+deferred_version_info_ready (QmiDevice *dev,
+                             GAsyncResult *res)
+{
+    GError *error = NULL;
+    GArray *services;
+
+    /* Without a reply the action runs as if the service was there */
+    services = qmi_device_get_service_version_info_finish (dev, res, &error);
+    if (!services) {
+        g_debug ("couldn't get service version info: %s", error->message);
+        g_error_free (error);
+        version_info_done (dev);
+        return;
+    }
+
+    version_info_cache_update (dev, services);
+    if (version_info_has_service (services, service))
+        version_info_done (dev);
+    else
+        version_info_reject ();
+    g_array_unref (services);
+}
+
+/* Version info is always queried alongside the client allocation, and the
+ * reply refreshes the cache. The cache is only advisory: when it lists the
+ * service, the action doesn't wait for the reply, which alone may turn the
+ * service down. Otherwise, and with transcripts so that replays do the
+ * same, the action waits for it. */
+static void
+device_check_version_info (QmiDevice *dev)
+{
+    gchar *cache_path;
+    GArray *services;
+
+    services = NULL;
+    if (!record_str && !replay_str) {
+        cache_path = qmicli_version_info_cache_get_path (qmi_device_get_path (dev));
+        services = qmicli_version_info_cache_load (cache_path);
+        g_free (cache_path);
+    }
+
+    version_info_wait = !(services && version_info_has_service (services, service));
+    if (services)
+        g_array_unref (services);
+
+    g_debug ("Getting service version info alongside client allocation...");
+    qmi_device_get_service_version_info (dev,
+                                         qmicli_request_timeout (device_request, 10),
+                                         qmicli_request_get_cancellable (device_request),
+                                         (GAsyncReadyCallback)deferred_version_info_ready,
+                                         NULL);
+}
+
 static void
 get_service_version_info_ready (QmiDevice *dev,
                                 GAsyncResult *res)
@@ -435,14 +812,16 @@ get_service_version_info_ready (QmiDevice *dev,
 
     services = qmi_device_get_service_version_info_finish (dev, res, &error);
     if (!services) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
              "success", 0,
              "error", "couldn't get service version info",
              "message", error->message
-              ),json_print_flag));
+              ));
         exit (EXIT_FAILURE);
     }
 
+    version_info_cache_update (dev, services);
+
     json_output = json_pack("{sbss}",
              "success", 1,
              "device", qmi_device_get_path_display (dev)
@@ -455,22 +834,21 @@ get_service_version_info_ready (QmiDevice *dev,
         info = &g_array_index (services, QmiDeviceServiceVersionInfo, i);
         service_str = qmi_service_get_string (info->service);
         if (service_str)
-            json_object_update(json_output,json_pack("{s{sisi}}",
+            qmicli_json_object_update_new (json_output,json_pack("{s{sisi}}",
                      service_str,
                                 "major", info->major_version,
                                 "minor", info->minor_version
                      ));
         else {
             g_snprintf(unknownhex,14,"unknown 0x%02x", info->service);
-            json_object_update(json_output,json_pack("s{sisi}",
+            qmicli_json_object_update_new (json_output,json_pack("{s{sisi}}",
                      unknownhex,
                                 "major", info->major_version,
                                 "minor", info->minor_version
                      ));
         }
     }
-    g_print ("%s\n", json_dumps(json_output,json_print_flag) ? : JSON_OUTPUT_ERROR);
-    g_free(json_output);
+    qmicli_output_json (json_output);
     g_array_unref (services);
 
     /* We're done now */
@@ -482,8 +860,8 @@ device_get_service_version_info (QmiDevice *dev)
 {
     g_debug ("Getting service version info...");
     qmi_device_get_service_version_info (dev,
-                                         10,
-                                         cancellable,
+                                         qmicli_request_timeout (device_request, 10),
+                                         qmicli_request_get_cancellable (device_request),
                                          (GAsyncReadyCallback)get_service_version_info_ready,
                                          NULL);
 }
@@ -494,12 +872,14 @@ device_open_ready (QmiDevice *dev,
 {
     GError *error = NULL;
 
+    startup_timer_stop ();
+
     if (!qmi_device_open_finish (dev, res, &error)) {
-            g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+            qmicli_output_json (json_pack("{sbssss}",
                 "success", 0,
                 "error", "couldn't open the QmiDevice",
                 "message", error->message
-                ),json_print_flag));
+                ));
         exit (EXIT_FAILURE);
     }
 
@@ -510,8 +890,15 @@ device_open_ready (QmiDevice *dev,
         device_set_instance_id (dev);
     else if (get_service_version_info_flag)
         device_get_service_version_info (dev);
-    else
+    else if (qmicli_subscribe_options_enabled ())
+        qmicli_subscribe_run (dev, cancellable);
+    else if (qmicli_snapshot_options_enabled ())
+        qmicli_snapshot_run (dev, cancellable);
+    else {
+        if (version_info_deferred)
+            device_check_version_info (dev);
         device_allocate_client (dev);
+    }
 }
 
 static void
@@ -523,17 +910,22 @@ device_new_ready (GObject *unused,
 
     device = qmi_device_new_finish (res, &error);
     if (!device) {
-        g_print ("%s\n", json_dumps(json_pack("{sbssss}",
+        qmicli_output_json (json_pack("{sbssss}",
               "success", 0,
               "error", "couldn't create QmiDevice",
               "message", error->message
-               ),json_print_flag));
+               ));
         exit (EXIT_FAILURE);
     }
 
-    /* Setup device open flags */
-    if (device_open_version_info_flag)
-        open_flags |= QMI_DEVICE_OPEN_FLAGS_VERSION_INFO;
+    /* Setup device open flags. For single client actions the version info
+     * query doesn't need to delay the open */
+    if (device_open_version_info_flag) {
+        if (service != QMI_SERVICE_CTL && service != QMI_SERVICE_UNKNOWN)
+            version_info_deferred = TRUE;
+        else
+            open_flags |= QMI_DEVICE_OPEN_FLAGS_VERSION_INFO;
+    }
     if (device_open_sync_flag)
         open_flags |= QMI_DEVICE_OPEN_FLAGS_SYNC;
     if (device_open_proxy_flag)
@@ -542,11 +934,15 @@ device_new_ready (GObject *unused,
         if (!qmicli_read_net_open_flags_from_string (device_open_net_str, &open_flags))
             exit (EXIT_FAILURE);
 
+    /* These already send requests while opening */
+    if (open_flags & (QMI_DEVICE_OPEN_FLAGS_VERSION_INFO | QMI_DEVICE_OPEN_FLAGS_SYNC))
+        startup_timer_stop ();
+
     /* Open the device */
     qmi_device_open (device,
                      open_flags,
-                     15,
-                     cancellable,
+                     qmicli_request_timeout (device_request, 15),
+                     qmicli_request_get_cancellable (device_request),
                      (GAsyncReadyCallback)device_open_ready,
                      NULL);
 }
@@ -594,81 +990,217 @@ parse_actions (void)
         actions_enabled++;
     }
 
+    /* Indication subscriptions? These allocate their own clients */
+    if (qmicli_subscribe_options_enabled ()) {
+        service = QMI_SERVICE_UNKNOWN;
+        actions_enabled++;
+    }
+
+    /* Status snapshot? Also with clients of its own */
+    if (qmicli_snapshot_options_enabled ()) {
+        service = QMI_SERVICE_UNKNOWN;
+        actions_enabled++;
+    }
+
     /* Cannot mix actions from different services */
     if (actions_enabled > 1) {
-        g_print ("%s\n", json_dumps(json_pack("{sbss}",
+        qmicli_output_json (json_pack("{sbss}",
              "success", 0,
              "error", "cannot execute multiple actions of different services"
-              ),json_print_flag));
+              ));
         exit (EXIT_FAILURE);
     }
 
     /* No options? */
     if (actions_enabled == 0) {
-        g_print ("%s\n", json_dumps(json_pack("{sbss}",
+        qmicli_output_json (json_pack("{sbss}",
              "success", 0,
              "error", "no actions specified"
-              ),json_print_flag));
+              ));
         exit (EXIT_FAILURE);
     }
 
     /* Go on! */
 }
 
+/* Option groups, only built when needed */
+static const struct {
+    const gchar *name;
+    GOptionGroup *(* get_option_group) (void);
+} option_groups[] = {
+    { "dms",       qmicli_dms_get_option_group },
+    { "nas",       qmicli_nas_get_option_group },
+    { "wds",       qmicli_wds_get_option_group },
+    { "pbm",       qmicli_pbm_get_option_group },
+    { "uim",       qmicli_uim_get_option_group },
+    { "subscribe", qmicli_subscribe_get_option_group },
+    { "snapshot",  qmicli_snapshot_get_option_group },
+};
+
+/* Services which may be given as subcommand */
+static const gchar *const subcommand_services[] = {
+    "dms", "nas", "wds", "pbm", "uim", NULL
+};
+
 int main (int argc, char **argv)
 {
     GError *error = NULL;
     GFile *file;
     GOptionContext *context;
+    gchar **args = argv;
+    gchar **subcommand_args = NULL;
+    gchar *subcommand_service = NULL;
+    guint i;
+
+    startup_timer = g_timer_new ();
+    qmicli_arena_init ();
 
     setlocale (LC_ALL, "");
 
     g_type_init ();
 
+    /* 'qmicli <service> <action> [args]' only needs that service's options */
+    if (qmicli_expand_subcommand (subcommand_services, main_entries, &argc, &args, &subcommand_service))
+        subcommand_args = args;
+
     /* Setup option context, process it and destroy it */
     context = g_option_context_new ("- Control QMI devices");
-        g_option_context_add_group (context,
-                                    qmicli_dms_get_option_group ());
-        g_option_context_add_group (context,
-                                    qmicli_nas_get_option_group ());
-        g_option_context_add_group (context,
-                                    qmicli_wds_get_option_group ());
-        g_option_context_add_group (context,
-                                    qmicli_pbm_get_option_group ());
-        g_option_context_add_group (context,
-                                    qmicli_uim_get_option_group ());
+    for (i = 0; i < G_N_ELEMENTS (option_groups); i++) {
+        if (!subcommand_service || g_str_equal (subcommand_service, option_groups[i].name))
+            g_option_context_add_group (context,
+                                        option_groups[i].get_option_group ());
+    }
     g_option_context_add_main_entries (context, main_entries, NULL);
-    if (!g_option_context_parse (context, &argc, &argv, &error)) {
-        g_print ("%s\n", json_dumps(json_pack("{sbss}",
+    if (!g_option_context_parse (context, &argc, &args, &error)) {
+        qmicli_output_json (json_pack("{sbss}",
              "success", 0,
              "error", error->message
-              ),JSON_PRESERVE_ORDER + JSON_INDENT(4)));
+              ));
         exit (EXIT_FAILURE);
     }
         g_option_context_free (context);
 
+    /* A service word left over wasn't taken as a subcommand, as some option
+     * other than the global ones came before it */
+    for (i = 1; !subcommand_service && i < (guint)argc; i++) {
+        guint j;
+
+        for (j = 0; subcommand_services[j]; j++) {
+            if (g_str_equal (subcommand_services[j], args[i]))
+                break;
+        }
+        if (subcommand_services[j]) {
+            gchar *message;
+
+            message = g_strdup_printf ("'%s' must come before any option other than the global ones",
+                                       args[i]);
+            qmicli_output_json (json_pack("{sbssss}",
+                 "success", 0,
+                 "error", "misplaced subcommand",
+                 "message", message
+                  ));
+            g_free (message);
+            exit (EXIT_FAILURE);
+        }
+    }
+
     if (json_flag)
         json_print_flag = JSON_PRESERVE_ORDER + JSON_COMPACT;
 
     if (version_flag)
         print_version_and_exit ();
 
+    if (fields_str) {
+        if (!qmicli_read_fields_from_string (fields_str, &fields)) {
+            qmicli_output_json (json_pack("{sbss}",
+                 "success", 0,
+                 "error", "failed to parse fields"
+                  ));
+            exit (EXIT_FAILURE);
+        }
+        qmicli_json_set_fields (fields);
+    }
+
+    if (timeout_secs < 0) {
+        qmicli_output_json (json_pack("{sbss}",
+             "success", 0,
+             "error", "--timeout must not be negative"
+              ));
+        exit (EXIT_FAILURE);
+    } else if (timeout_secs > 0)
+        deadline = g_get_monotonic_time () + (gint64)timeout_secs * G_USEC_PER_SEC;
+
+    if (monitor_diff < 0) {
+        qmicli_output_json (json_pack("{sbss}",
+             "success", 0,
+             "error", "--monitor-diff must not be negative"
+              ));
+        exit (EXIT_FAILURE);
+    }
+    qmicli_output_set_monitor_keyframe (monitor_diff);
+
+    if (record_str && replay_str) {
+        qmicli_output_json (json_pack("{sbss}",
+             "success", 0,
+             "error", "--record cannot be used with --replay"
+              ));
+        exit (EXIT_FAILURE);
+    }
+
+    if ((record_str || replay_str) && (device_open_proxy_flag || client_cid_registry_flag)) {
+        qmicli_output_json (json_pack("{sbss}",
+             "success", 0,
+             "error", "--record and --replay cannot be used with --device-open-proxy or --client-cid-registry"
+              ));
+        exit (EXIT_FAILURE);
+    }
+
+    if (client_cid_registry_flag && client_cid_str) {
+        qmicli_output_json (json_pack("{sbss}",
+             "success", 0,
+             "error", "--client-cid-registry cannot be used with --client-cid"
+              ));
+        exit (EXIT_FAILURE);
+    }
+
     g_log_set_handler (NULL, G_LOG_LEVEL_MASK, log_handler, NULL);
     g_log_set_handler ("Qmi", G_LOG_LEVEL_MASK, log_handler, NULL);
     if (verbose_flag)
         qmi_utils_set_traces_enabled (TRUE);
 
-    /* No device path given? */
-    if (!device_str) {
-        g_print ("%s\n", json_dumps(json_pack("{sbss}",
+    /* Exporting a sample log needs no device */
+    if (qmicli_subscribe_log_export_enabled ())
+        exit (qmicli_subscribe_log_export () ? EXIT_SUCCESS : EXIT_FAILURE);
+
+    /* No device path given? Not needed when replaying */
+    if (!device_str && !replay_str) {
+        qmicli_output_json (json_pack("{sbss}",
              "success", 0,
              "error", "no device path specified"
-              ),json_print_flag));
+              ));
         exit (EXIT_FAILURE);
     }
 
-    /* Build new GFile from the commandline arg */
-    file = g_file_new_for_commandline_arg (device_str);
+    /* When recording or replaying, the QmiDevice gets a stand-in */
+    if (record_str || replay_str) {
+        gchar *stand_in;
+
+        stand_in = (record_str ?
+                    qmicli_transcript_record (device_str, record_str, &error) :
+                    qmicli_transcript_replay (replay_str, &error));
+        if (!stand_in) {
+            qmicli_output_json (json_pack("{sbssss}",
+                 "success", 0,
+                 "error", record_str ? "couldn't record" : "couldn't replay",
+                 "message", error->message
+                  ));
+            exit (EXIT_FAILURE);
+        }
+        file = g_file_new_for_path (stand_in);
+        g_free (stand_in);
+    } else
+        /* Build new GFile from the commandline arg */
+        file = g_file_new_for_commandline_arg (device_str);
 
     /* Setup signals */
     signal (SIGINT, signals_handler);
@@ -679,11 +1211,12 @@ int main (int argc, char **argv)
 
     /* Create requirements for async options */
     cancellable = g_cancellable_new ();
+    device_request = qmicli_request_new (cancellable, deadline);
     loop = g_main_loop_new (NULL, FALSE);
 
     /* Launch QmiDevice creation */
     qmi_device_new (file,
-                    cancellable,
+                    qmicli_request_get_cancellable (device_request),
                     (GAsyncReadyCallback)device_new_ready,
                     GUINT_TO_POINTER (service));
     g_main_loop_run (loop);
@@ -696,6 +1229,14 @@ int main (int argc, char **argv)
         g_object_unref (device);
     g_main_loop_unref (loop);
     g_object_unref (file);
+    qmicli_fields_free (fields);
+    qmicli_request_free (device_request);
+    qmicli_transcript_stop ();
+    qmicli_coalesce_shutdown ();
+    qmicli_output_shutdown ();
+    qmicli_arena_shutdown ();
+    g_strfreev (subcommand_args);
+    g_free (subcommand_service);
 
     return (operation_status ? EXIT_SUCCESS : EXIT_FAILURE);
 }
@@ -29,8 +29,228 @@
 extern size_t json_print_flag;
 extern const char *JSON_OUTPUT_ERROR;
 
+/* json_object_update() consuming the new values, e.g. from json_pack() */
+static inline int
+qmicli_json_object_update_new (json_t *object,
+                               json_t *other)
+{
+    int ret;
+
+    ret = json_object_update (object, other);
+    json_decref (other);
+    return ret;
+}
+
+/* Requests, each with its own cancellable and an optional deadline in
+ * monotonic time; timeouts of the calls they make are clamped to it */
+typedef struct _QmicliRequest QmicliRequest;
+
+QmicliRequest *qmicli_request_new             (GCancellable *parent,
+                                               gint64 deadline);
+void           qmicli_request_free            (QmicliRequest *request);
+GCancellable  *qmicli_request_get_cancellable (QmicliRequest *request);
+gboolean       qmicli_request_expired         (QmicliRequest *request);
+guint          qmicli_request_timeout         (QmicliRequest *request,
+                                               guint timeout);
+
+/* Scheduling of requests per service, by priority class and owner */
+typedef enum {
+    QMICLI_PRIORITY_INTERACTIVE,
+    QMICLI_PRIORITY_PERIODIC,
+    QMICLI_PRIORITY_BULK,
+    QMICLI_PRIORITY_LAST
+} QmicliPriority;
+
+typedef struct _QmicliJob QmicliJob;
+typedef void (* QmicliJobFunc) (QmicliJob *job,
+                                gpointer user_data);
+
+void qmicli_scheduler_submit    (QmiService service,
+                                 QmicliPriority priority,
+                                 const gchar *owner,
+                                 QmicliJobFunc func,
+                                 gpointer user_data);
+void qmicli_scheduler_done      (QmicliJob *job);
+void qmicli_scheduler_set_limit (QmiService service,
+                                 guint limit);
+
+/* Coalescing of identical read-only requests in flight, and caching of
+ * their responses. The method and finish functions are the libqmi client
+ * ones for the message.
+ *
+ * Waiters are completed with a GSimpleAsyncResult built here, not with the
+ * one libqmi created for the transaction, so this relies on the libqmi
+ * _finish() functions taking any GSimpleAsyncResult: they only propagate
+ * its error or ref its op_res_gpointer, and never check the source tag.
+ * That holds while libqmi uses GSimpleAsyncResult; qmicli-coalesce.c
+ * asserts the libqmi version so that a move to GTask fails the build. */
+typedef void     (* QmicliCoalesceMethod) (gpointer client,
+                                           gpointer input,
+                                           guint timeout,
+                                           GCancellable *cancellable,
+                                           GAsyncReadyCallback callback,
+                                           gpointer user_data);
+typedef gpointer (* QmicliCoalesceFinish) (gpointer client,
+                                           GAsyncResult *res,
+                                           GError **error);
+
+typedef gboolean (* QmicliCoalesceResult) (gpointer output,
+                                           GError **error);
+
+/* Successful responses are cached for 'ttl_ms', if not 0 */
+typedef struct {
+    const gchar *name;
+    guint ttl_ms;
+    QmicliCoalesceMethod method;
+    QmicliCoalesceFinish finish;
+    QmicliCoalesceResult get_result;
+    GBoxedCopyFunc output_ref;
+    GDestroyNotify output_unref;
+} QmicliCoalescedMessage;
+
+#define QMICLI_COALESCED_MESSAGE(service, message, ttl_ms)                      \
+    { #service "/" #message,                                                    \
+      ttl_ms,                                                                   \
+      (QmicliCoalesceMethod) qmi_client_##service##_##message,                  \
+      (QmicliCoalesceFinish) qmi_client_##service##_##message##_finish,         \
+      (QmicliCoalesceResult) qmi_message_##service##_##message##_output_get_result, \
+      (GBoxedCopyFunc) qmi_message_##service##_##message##_output_ref,          \
+      (GDestroyNotify) qmi_message_##service##_##message##_output_unref }
+
+void qmicli_coalesce_call (const QmicliCoalescedMessage *message,
+                           GObject *client,
+                           gpointer input,
+                           const gchar *input_key,
+                           guint timeout,
+                           GCancellable *cancellable,
+                           GAsyncReadyCallback callback,
+                           gpointer user_data);
+void qmicli_coalesce_invalidate   (const gchar *prefix);
+void qmicli_coalesce_json_add_age (json_t *json,
+                                   GAsyncResult *res);
+void qmicli_coalesce_shutdown     (void);
+
+/* Arena backing all JSON values */
+void          qmicli_arena_init            (void);
+void          qmicli_arena_shutdown        (void);
+gulong        qmicli_arena_get_live        (void);
+gboolean      qmicli_arena_check           (const gchar *where);
+
+/* Registry of CIDs kept allocated between invocations, one file per device */
+gchar    *qmicli_cid_registry_get_path (const gchar *device_path);
+gboolean  qmicli_cid_registry_take     (const gchar *registry_path,
+                                        const gchar *service,
+                                        guint8 *out_cid,
+                                        GError **error);
+gboolean  qmicli_cid_registry_put      (const gchar *registry_path,
+                                        const gchar *service,
+                                        guint8 cid,
+                                        GError **error);
+
+/* Cache of the service version info reported by each device */
+gchar    *qmicli_version_info_cache_get_path (const gchar *device_path);
+GArray   *qmicli_version_info_cache_load     (const gchar *cache_path);
+gboolean  qmicli_version_info_cache_save     (const gchar *cache_path,
+                                              GArray *services,
+                                              GError **error);
+
+/* Fixed-size ring of samples: a timestamp plus one gint16 per column, each
+ * column stored apart. Once full, new samples replace the oldest ones. */
+#define QMICLI_HISTORY_MISSING G_MININT16
+
+typedef struct _QmicliHistory QmicliHistory;
+
+typedef struct {
+    guint count;
+    gint16 min;
+    gint16 max;
+    gdouble avg;
+} QmicliHistoryAggregate;
+
+QmicliHistory *qmicli_history_new        (guint capacity,
+                                          guint n_columns);
+void           qmicli_history_free       (QmicliHistory *history);
+void           qmicli_history_append     (QmicliHistory *history,
+                                          gint64 timestamp,
+                                          const gint16 *values);
+guint          qmicli_history_get_length (QmicliHistory *history);
+gint64         qmicli_history_get_timestamp (QmicliHistory *history,
+                                             guint index);
+gint16         qmicli_history_get_value  (QmicliHistory *history,
+                                          guint index,
+                                          guint column);
+guint          qmicli_history_last       (QmicliHistory *history,
+                                          guint n,
+                                          guint *out_first);
+guint          qmicli_history_range      (QmicliHistory *history,
+                                          gint64 from,
+                                          gint64 to,
+                                          guint *out_first);
+void           qmicli_history_aggregate  (QmicliHistory *history,
+                                          guint first,
+                                          guint count,
+                                          guint column,
+                                          QmicliHistoryAggregate *out);
+
+/* Append-only log of samples like the above, in segment files under a
+ * directory, bounded in number */
+#define QMICLI_SAMPLE_LOG_SCHEMA_VERSION 1
+#define QMICLI_SAMPLE_LOG_MAX_COLUMNS    16
+
+typedef struct _QmicliSampleLog QmicliSampleLog;
+
+typedef void (* QmicliSampleLogFunc) (const gchar *const *columns,
+                                      gint64 timestamp,
+                                      const gint16 *values,
+                                      gpointer user_data);
+
+QmicliSampleLog *qmicli_sample_log_open   (const gchar *dir,
+                                           const gchar *const *columns,
+                                           guint max_segments,
+                                           GError **error);
+void             qmicli_sample_log_close  (QmicliSampleLog *log);
+gboolean         qmicli_sample_log_append (QmicliSampleLog *log,
+                                           gint64 timestamp,
+                                           const gint16 *values,
+                                           GError **error);
+gboolean         qmicli_sample_log_read   (const gchar *dir,
+                                           gint64 from,
+                                           gint64 to,
+                                           QmicliSampleLogFunc func,
+                                           gpointer user_data,
+                                           guint *out_corrupt,
+                                           GError **error);
+
+/* Recording and replaying of the traffic with a device */
+gchar        *qmicli_transcript_record     (const gchar *device_path,
+                                            const gchar *transcript_path,
+                                            GError **error);
+gchar        *qmicli_transcript_replay     (const gchar *transcript_path,
+                                            GError **error);
+gchar        *qmicli_transcript_serve      (const gchar *transcript_path,
+                                            GError **error);
+void          qmicli_transcript_stop       (void);
+
 /* Common */
 void          qmicli_async_operation_done  (gboolean operation_status);
+gint64        qmicli_get_deadline          (void);
+QmiDeviceReleaseClientFlags qmicli_release_client_flags (void);
+
+/* Output sink; documents are consumed */
+void          qmicli_output_json       (json_t *document);
+void          qmicli_output_json_full  (json_t *document,
+                                        size_t flags);
+void          qmicli_output_shutdown   (void);
+
+/* Monitor lines; with a keyframe interval set, only the changes since the
+ * previous line of the same stream are printed between keyframes */
+void          qmicli_output_set_monitor_keyframe (guint every);
+void          qmicli_output_json_monitor         (const gchar *stream,
+                                                  const gchar *const *keep,
+                                                  json_t *document,
+                                                  size_t flags);
+json_t       *qmicli_json_merge_diff             (json_t *from,
+                                                  json_t *to);
 
 /* DMS group */
 GOptionGroup *qmicli_dms_get_option_group (void);
@@ -66,6 +286,20 @@ gboolean      qmicli_uim_options_enabled  (void);
 void          qmicli_uim_run              (QmiDevice *device,
                                            QmiClientUim *client,
                                            GCancellable *cancellable);
+/* Indication subscriptions */
+GOptionGroup *qmicli_subscribe_get_option_group (void);
+gboolean      qmicli_subscribe_options_enabled  (void);
+void          qmicli_subscribe_run              (QmiDevice *device,
+                                                 GCancellable *cancellable);
+gboolean      qmicli_subscribe_log_export_enabled (void);
+gboolean      qmicli_subscribe_log_export         (void);
+
+/* Status snapshot */
+GOptionGroup *qmicli_snapshot_get_option_group (void);
+gboolean      qmicli_snapshot_options_enabled  (void);
+void          qmicli_snapshot_run              (QmiDevice *device,
+                                                GCancellable *cancellable);
+
 /* JSON iteration and print legacy output) */
 void print_json_array(json_t *object, int nested_level);
 void print_json_object(json_t *object, int nested_level);
@@ -0,0 +1,431 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * qmicli -- Command line interface to control QMI devices
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Throughput of the generated JSON serializers, without any modem latency.
+ *
+ * The corpus is a directory of transcripts written with 'qmicli --record',
+ * one per message, named after the qmicli action, e.g.:
+ *
+ *   qmicli -d /dev/cdc-wdm0 --nas-get-system-info --record=nas-get-system-info.qmt
+ *
+ * Each transcript is served once to a QmiDevice to get the parsed output
+ * bundle, which is then serialized over and over in every output mode. */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <libqmi-glib.h>
+#include <jansson.h>
+
+#include "qmicli.h"
+#include "qmicli-json-generated.h"
+
+#define CORPUS_TIMEOUT 10
+
+typedef void     (* CorpusRequest)   (QmiClient *client,
+                                      GAsyncReadyCallback callback);
+typedef gpointer (* CorpusFinish)    (QmiClient *client,
+                                      GAsyncResult *res,
+                                      GError **error);
+typedef void     (* CorpusSerialize) (gpointer output,
+                                      json_t *json);
+
+typedef struct {
+    const gchar *name;
+    QmiService service;
+    CorpusRequest request;
+    CorpusFinish finish;
+    CorpusSerialize serialize;
+    GDestroyNotify unref;
+} CorpusMessage;
+
+#define CORPUS_MESSAGE(name, service, message, SERVICE)                         \
+    { name,                                                                     \
+      QMI_SERVICE_##SERVICE,                                                    \
+      request_##service##_##message,                                            \
+      (CorpusFinish) qmi_client_##service##_##message##_finish,                 \
+      (CorpusSerialize) qmicli_json_##service##_##message##_output,             \
+      (GDestroyNotify) qmi_message_##service##_##message##_output_unref }
+
+/* The transcript answers whatever the input, but these match the actions
+ * named in the corpus */
+
+static void
+request_nas_get_system_info (QmiClient *client,
+                             GAsyncReadyCallback callback)
+{
+    qmi_client_nas_get_system_info (QMI_CLIENT_NAS (client), NULL, CORPUS_TIMEOUT, NULL, callback, NULL);
+}
+
+static void
+request_nas_get_signal_info (QmiClient *client,
+                             GAsyncReadyCallback callback)
+{
+    qmi_client_nas_get_signal_info (QMI_CLIENT_NAS (client), NULL, CORPUS_TIMEOUT, NULL, callback, NULL);
+}
+
+static void
+request_nas_network_scan (QmiClient *client,
+                          GAsyncReadyCallback callback)
+{
+    qmi_client_nas_network_scan (QMI_CLIENT_NAS (client), NULL, CORPUS_TIMEOUT, NULL, callback, NULL);
+}
+
+static void
+request_wds_get_profile_settings (QmiClient *client,
+                                  GAsyncReadyCallback callback)
+{
+    QmiMessageWdsGetProfileSettingsInput *input;
+
+    input = qmi_message_wds_get_profile_settings_input_new ();
+    qmi_message_wds_get_profile_settings_input_set_profile_id (input, QMI_WDS_PROFILE_TYPE_3GPP, 1, NULL);
+    qmi_client_wds_get_profile_settings (QMI_CLIENT_WDS (client), input, CORPUS_TIMEOUT, NULL, callback, NULL);
+    qmi_message_wds_get_profile_settings_input_unref (input);
+}
+
+/* EF ICCID, as in --uim-get-file-attributes=0x3F00,0x2FE2 */
+static void
+request_uim_get_file_attributes (QmiClient *client,
+                                 GAsyncReadyCallback callback)
+{
+    QmiMessageUimGetFileAttributesInput *input;
+    GArray *file_path;
+    static const guint8 master_file[] = { 0x00, 0x3F };
+
+    file_path = g_array_sized_new (FALSE, FALSE, sizeof (guint8), G_N_ELEMENTS (master_file));
+    g_array_append_vals (file_path, master_file, G_N_ELEMENTS (master_file));
+
+    input = qmi_message_uim_get_file_attributes_input_new ();
+    qmi_message_uim_get_file_attributes_input_set_session_information (
+        input,
+        QMI_UIM_SESSION_TYPE_PRIMARY_GW_PROVISIONING,
+        "",
+        NULL);
+    qmi_message_uim_get_file_attributes_input_set_file (input, 0x2FE2, file_path, NULL);
+    qmi_client_uim_get_file_attributes (QMI_CLIENT_UIM (client), input, CORPUS_TIMEOUT, NULL, callback, NULL);
+    qmi_message_uim_get_file_attributes_input_unref (input);
+    g_array_unref (file_path);
+}
+
+static void
+request_pbm_get_all_capabilities (QmiClient *client,
+                                  GAsyncReadyCallback callback)
+{
+    qmi_client_pbm_get_all_capabilities (QMI_CLIENT_PBM (client), NULL, CORPUS_TIMEOUT, NULL, callback, NULL);
+}
+
+static const CorpusMessage corpus[] = {
+    CORPUS_MESSAGE ("nas-get-system-info",      nas, get_system_info,      NAS),
+    CORPUS_MESSAGE ("nas-get-signal-info",      nas, get_signal_info,      NAS),
+    CORPUS_MESSAGE ("nas-network-scan",         nas, network_scan,         NAS),
+    /* Settings of the first profile listed */
+    CORPUS_MESSAGE ("wds-get-profile-list",     wds, get_profile_settings, WDS),
+    CORPUS_MESSAGE ("uim-get-file-attributes",  uim, get_file_attributes,  UIM),
+    CORPUS_MESSAGE ("pbm-get-all-capabilities", pbm, get_all_capabilities, PBM),
+};
+
+typedef enum {
+    OUTPUT_MODE_PRETTY,
+    OUTPUT_MODE_COMPACT,
+    OUTPUT_MODE_STREAMING,
+} OutputMode;
+
+static const gchar *output_mode_names[] = { "pretty", "compact", "streaming" };
+
+/*****************************************************************************/
+/* Loading the corpus */
+
+static GMainLoop *loop;
+static GAsyncResult *result;
+
+static void
+async_ready (GObject *unused,
+             GAsyncResult *res,
+             gpointer unused_data)
+{
+    result = g_object_ref (res);
+    g_main_loop_quit (loop);
+}
+
+/* Runs the main loop until async_ready() is called; the caller owns the result */
+static GAsyncResult *
+wait_for_result (void)
+{
+    GAsyncResult *res;
+
+    g_main_loop_run (loop);
+    res = result;
+    result = NULL;
+    return res;
+}
+
+static gpointer
+corpus_message_load (const CorpusMessage *message,
+                     const gchar *transcript_path,
+                     GError **error)
+{
+    GAsyncResult *res;
+    gchar *stand_in;
+    GFile *file;
+    QmiDevice *device = NULL;
+    QmiClient *client = NULL;
+    gpointer output = NULL;
+
+    stand_in = qmicli_transcript_serve (transcript_path, error);
+    if (!stand_in)
+        return NULL;
+
+    file = g_file_new_for_path (stand_in);
+    g_free (stand_in);
+    qmi_device_new (file, NULL, async_ready, NULL);
+    g_object_unref (file);
+    res = wait_for_result ();
+    device = qmi_device_new_finish (res, error);
+    g_object_unref (res);
+    if (!device)
+        goto out;
+
+    qmi_device_open (device, QMI_DEVICE_OPEN_FLAGS_NONE, CORPUS_TIMEOUT, NULL, async_ready, NULL);
+    res = wait_for_result ();
+    if (!qmi_device_open_finish (device, res, error)) {
+        g_object_unref (res);
+        goto out;
+    }
+    g_object_unref (res);
+
+    qmi_device_allocate_client (device, message->service, QMI_CID_NONE, CORPUS_TIMEOUT, NULL, async_ready, NULL);
+    res = wait_for_result ();
+    client = qmi_device_allocate_client_finish (device, res, error);
+    g_object_unref (res);
+    if (!client)
+        goto out;
+
+    message->request (client, async_ready);
+    res = wait_for_result ();
+    output = message->finish (client, res, error);
+    g_object_unref (res);
+
+    /* Not asking to release the CID, so that the transcript needn't have it */
+    qmi_device_release_client (device, client, QMI_DEVICE_RELEASE_CLIENT_FLAGS_NONE, CORPUS_TIMEOUT, NULL, async_ready, NULL);
+    res = wait_for_result ();
+    qmi_device_release_client_finish (device, res, NULL);
+    g_object_unref (res);
+
+out:
+    if (client)
+        g_object_unref (client);
+    if (device) {
+        qmi_device_close (device, NULL);
+        g_object_unref (device);
+    }
+    qmicli_transcript_stop ();
+    return output;
+}
+
+/*****************************************************************************/
+/* Serializing */
+
+/* Every Jansson allocation goes through here, as it goes through the arena
+ * in qmicli */
+static gulong n_allocations;
+
+static void *
+counting_malloc (size_t size)
+{
+    n_allocations++;
+    return malloc (size);
+}
+
+static int
+streaming_callback (const char *data,
+                    size_t size,
+                    void *user_data)
+{
+    g_string_append_len ((GString *)user_data, data, size);
+    return 0;
+}
+
+/* Builds and dumps the document once, returning the bytes written out */
+static gsize
+serialize_once (const CorpusMessage *message,
+                gpointer output,
+                OutputMode mode,
+                GString *stream)
+{
+    json_t *json;
+    gchar *dumped;
+    gsize length = 0;
+
+    json = json_object ();
+    message->serialize (output, json);
+
+    switch (mode) {
+    case OUTPUT_MODE_PRETTY:
+    case OUTPUT_MODE_COMPACT:
+        dumped = json_dumps (json,
+                             JSON_PRESERVE_ORDER |
+                             (mode == OUTPUT_MODE_PRETTY ? JSON_INDENT (4) : JSON_COMPACT));
+        if (dumped) {
+            length = strlen (dumped);
+            free (dumped);
+        }
+        break;
+    case OUTPUT_MODE_STREAMING:
+        /* Into a reused buffer, as qmicli_output_json() does */
+        g_string_truncate (stream, 0);
+        json_dump_callback (json, streaming_callback, stream, JSON_PRESERVE_ORDER | JSON_COMPACT);
+        length = stream->len;
+        break;
+    }
+
+    json_decref (json);
+    return length + 1;
+}
+
+static json_t *
+benchmark (const CorpusMessage *message,
+           gpointer output,
+           OutputMode mode,
+           guint iterations)
+{
+    GString *stream;
+    gint64 start;
+    gint64 elapsed;
+    gulong allocations;
+    gsize bytes = 0;
+    gdouble ns;
+    guint i;
+
+    stream = g_string_sized_new (4096);
+
+    /* Warm up caches and the stream buffer */
+    for (i = 0; i < MAX (iterations / 10, 1); i++)
+        serialize_once (message, output, mode, stream);
+
+    allocations = n_allocations;
+    start = g_get_monotonic_time ();
+    for (i = 0; i < iterations; i++)
+        bytes = serialize_once (message, output, mode, stream);
+    elapsed = MAX (g_get_monotonic_time () - start, 1);
+    allocations = n_allocations - allocations;
+
+    g_string_free (stream, TRUE);
+
+    ns = (gdouble)elapsed * 1000.0 / iterations;
+    return json_pack ("{sssssfsfsfsI}",
+                      "message", message->name,
+                      "mode", output_mode_names[mode],
+                      "messages per second", 1e9 / ns,
+                      "ns per message", ns,
+                      "allocations per message", (gdouble)allocations / iterations,
+                      "bytes out", (json_int_t)bytes);
+}
+
+/*****************************************************************************/
+
+static gchar *corpus_str;
+static gint iterations = 10000;
+
+static GOptionEntry entries[] = {
+    { "corpus", 'c', 0, G_OPTION_ARG_FILENAME, &corpus_str,
+      "Directory with one transcript per message (default: current directory)",
+      "[DIR]"
+    },
+    { "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+      "Serializations of each message in each mode (default: 10000)",
+      "[N]"
+    },
+    { NULL }
+};
+
+int main (int argc, char **argv)
+{
+    GOptionContext *context;
+    GError *error = NULL;
+    json_t *results;
+    json_t *skipped;
+    json_t *report;
+    guint i;
+
+    setlocale (LC_ALL, "");
+    g_type_init ();
+
+    context = g_option_context_new ("- benchmark the JSON serializers over a corpus of QMI messages");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error)) {
+        g_printerr ("error: %s\n", error->message);
+        exit (EXIT_FAILURE);
+    }
+    g_option_context_free (context);
+
+    if (iterations <= 0) {
+        g_printerr ("error: iterations must be positive\n");
+        exit (EXIT_FAILURE);
+    }
+
+    json_set_alloc_funcs (counting_malloc, free);
+    loop = g_main_loop_new (NULL, FALSE);
+
+    results = json_array ();
+    skipped = json_array ();
+    for (i = 0; i < G_N_ELEMENTS (corpus); i++) {
+        gchar *basename;
+        gchar *path;
+        gpointer output;
+        OutputMode mode;
+
+        basename = g_strdup_printf ("%s.qmt", corpus[i].name);
+        path = g_build_filename (corpus_str ? corpus_str : ".", basename, NULL);
+        g_free (basename);
+
+        output = corpus_message_load (&corpus[i], path, &error);
+        g_free (path);
+        if (!output) {
+            json_array_append_new (skipped, json_pack ("{ssss}",
+                                                       "message", corpus[i].name,
+                                                       "reason", error->message));
+            g_clear_error (&error);
+            continue;
+        }
+
+        for (mode = OUTPUT_MODE_PRETTY; mode <= OUTPUT_MODE_STREAMING; mode++)
+            json_array_append_new (results, benchmark (&corpus[i], output, mode, iterations));
+        corpus[i].unref (output);
+    }
+
+    report = json_pack ("{sisOsO}",
+                        "iterations", iterations,
+                        "results", results,
+                        "skipped", skipped);
+    json_dumpf (report, stdout, JSON_PRESERVE_ORDER | JSON_INDENT (4));
+    fputc ('\n', stdout);
+    json_decref (report);
+
+    g_main_loop_unref (loop);
+    i = json_array_size (results);
+    json_decref (results);
+    json_decref (skipped);
+    return i ? EXIT_SUCCESS : EXIT_FAILURE;
+}
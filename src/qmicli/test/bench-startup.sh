@@ -0,0 +1,54 @@
+#!/bin/sh
+#
+# Time from qmicli's main() to its first QMI request, for the legacy command
+# line (every option group built and parsed) and for the subcommand one (only
+# the selected service's). A transcript is replayed so that no modem is
+# needed and the numbers don't depend on one:
+#
+#   qmicli -d /dev/cdc-wdm0 --nas-get-signal-info --record=startup.qmt
+#   ./bench-startup.sh startup.qmt [runs]
+#
+# QMICLI overrides the binary to run (default: ../qmicli). Besides qmicli's
+# own figure, the wall time of the whole run is given, which includes
+# process start-up and dynamic linking.
+
+set -e
+
+if [ $# -lt 1 ]; then
+    echo "usage: $0 TRANSCRIPT [RUNS]" >&2
+    exit 1
+fi
+
+transcript=$1
+runs=${2:-200}
+qmicli=${QMICLI:-$(dirname "$0")/../qmicli}
+
+# Prints "<ms to first request> <ms wall time>" for each run
+bench () {
+    i=0
+    while [ $i -lt "$runs" ]; do
+        start=$(date +%s%N)
+        startup=$("$qmicli" "$@" --replay="$transcript" --verbose 2>/dev/null |
+                  sed -n 's/.*Startup took \([0-9.]*\) ms.*/\1/p')
+        end=$(date +%s%N)
+        if [ -z "$startup" ]; then
+            echo "error: no startup time reported by: $qmicli $*" >&2
+            exit 1
+        fi
+        echo "$startup $(( (end - start) / 1000 ))"
+        i=$((i + 1))
+    done
+}
+
+# Mean and median of both columns
+summary () {
+    sort -n | awk -v name="$1" '
+        { startup[NR] = $1; startup_sum += $1; wall_sum += $2 / 1000.0 }
+        END {
+            printf "%-12s runs %d  first request: mean %.3f ms, median %.3f ms  wall: mean %.3f ms\n",
+                   name, NR, startup_sum / NR, startup[int((NR + 1) / 2)], wall_sum / NR
+        }'
+}
+
+bench --nas-get-signal-info | summary legacy
+bench nas get-signal-info | summary subcommand
@@ -0,0 +1,101 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <libqmi-glib.h>
+#include <jansson.h>
+
+#include "qmicli.h"
+
+static void
+test_arena_rewind (void)
+{
+    json_t *first;
+    json_t *second;
+    json_t *array;
+    gpointer address;
+    guint round;
+    guint i;
+
+    qmicli_arena_init ();
+
+    first = json_object ();
+    json_object_set_new (first, "rssi", json_integer (-70));
+    g_assert_cmpuint (qmicli_arena_get_live (), >, 0);
+    address = first;
+    json_decref (first);
+    g_assert_cmpuint (qmicli_arena_get_live (), ==, 0);
+    g_assert (qmicli_arena_check ("a test line"));
+
+    /* Rewound: the next value starts where the first one did */
+    second = json_object ();
+    g_assert (second == address);
+    json_decref (second);
+
+    /* A response needing several chunks leaves a single one big enough for
+     * all of it, where the next ones of the same size fit */
+    for (round = 0; round < 3; round++) {
+        array = json_array ();
+        for (i = 0; i < 4096; i++)
+            json_array_append_new (array, json_string ("-70 dBm"));
+        if (round == 1)
+            address = array;
+        else if (round == 2)
+            g_assert (array == address);
+        json_decref (array);
+        g_assert_cmpuint (qmicli_arena_get_live (), ==, 0);
+    }
+    g_assert (qmicli_arena_check ("a test line"));
+
+    qmicli_arena_shutdown ();
+}
+
+static void
+test_arena_leak (void)
+{
+    json_t *leaked;
+    json_t *line;
+
+    qmicli_arena_init ();
+
+    /* A value still alive once a line is out is reported */
+    leaked = json_string ("kept by mistake");
+    line = json_object ();
+    json_decref (line);
+
+    g_test_expect_message (NULL, G_LOG_LEVEL_WARNING, "*leaked*");
+    g_assert (!qmicli_arena_check ("a test line"));
+    g_test_assert_expected_messages ();
+
+    /* Once, not on every line */
+    g_assert (!qmicli_arena_check ("a test line"));
+
+    json_decref (leaked);
+    g_assert_cmpuint (qmicli_arena_get_live (), ==, 0);
+    g_assert (qmicli_arena_check ("a test line"));
+
+    qmicli_arena_shutdown ();
+}
+
+int main (int argc, char **argv)
+{
+    g_type_init ();
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/qmicli/arena/rewind", test_arena_rewind);
+    g_test_add_func ("/qmicli/arena/leak", test_arena_leak);
+
+    return g_test_run ();
+}
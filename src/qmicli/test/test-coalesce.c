@@ -0,0 +1,229 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <libqmi-glib.h>
+#include <jansson.h>
+
+#include "qmicli.h"
+
+/* A fake client method: transactions stay pending until the test completes
+ * them, with a GArray as output */
+
+static GSList *pending;
+static GSList *pending_cancellables;
+static guint n_transactions;
+
+static void
+fake_method (gpointer client,
+             gpointer input,
+             guint timeout,
+             GCancellable *cancellable,
+             GAsyncReadyCallback callback,
+             gpointer user_data)
+{
+    n_transactions++;
+    pending = g_slist_append (pending,
+                              g_simple_async_result_new (client, callback, user_data, fake_method));
+    pending_cancellables = g_slist_append (pending_cancellables,
+                                           cancellable ? g_object_ref (cancellable) : NULL);
+}
+
+static gpointer
+fake_finish (gpointer client,
+             GAsyncResult *res,
+             GError **error)
+{
+    if (g_simple_async_result_propagate_error (G_SIMPLE_ASYNC_RESULT (res), error))
+        return NULL;
+    return g_array_ref (g_simple_async_result_get_op_res_gpointer (G_SIMPLE_ASYNC_RESULT (res)));
+}
+
+static gboolean
+fake_get_result (gpointer output,
+                 GError **error)
+{
+    return TRUE;
+}
+
+static const QmicliCoalescedMessage fake_message = {
+    "fake/read",
+    1000,
+    (QmicliCoalesceMethod) fake_method,
+    (QmicliCoalesceFinish) fake_finish,
+    (QmicliCoalesceResult) fake_get_result,
+    (GBoxedCopyFunc) g_array_ref,
+    (GDestroyNotify) g_array_unref
+};
+
+/* Completes the oldest pending transaction with 'value', or cancelled */
+static void
+fake_complete (gint value)
+{
+    GSimpleAsyncResult *result;
+    GCancellable *cancellable;
+
+    g_assert (pending);
+    result = pending->data;
+    cancellable = pending_cancellables->data;
+    pending = g_slist_delete_link (pending, pending);
+    pending_cancellables = g_slist_delete_link (pending_cancellables, pending_cancellables);
+
+    if (cancellable && g_cancellable_is_cancelled (cancellable))
+        g_simple_async_result_set_error (result, G_IO_ERROR, G_IO_ERROR_CANCELLED, "cancelled");
+    else {
+        GArray *output;
+
+        output = g_array_new (FALSE, FALSE, sizeof (gint));
+        g_array_append_val (output, value);
+        g_simple_async_result_set_op_res_gpointer (result, output, (GDestroyNotify)g_array_unref);
+    }
+    g_simple_async_result_complete (result);
+    g_object_unref (result);
+    if (cancellable)
+        g_object_unref (cancellable);
+}
+
+/* Value each caller got: -1 while waiting, 0 if cancelled */
+static void
+call_ready (GObject *client,
+            GAsyncResult *res,
+            gint *value)
+{
+    GArray *output;
+
+    output = fake_finish (client, res, NULL);
+    if (!output) {
+        *value = 0;
+        return;
+    }
+    *value = g_array_index (output, gint, 0);
+    g_array_unref (output);
+}
+
+static void
+call (GObject *client,
+      GCancellable *cancellable,
+      gint *value)
+{
+    *value = -1;
+    qmicli_coalesce_call (&fake_message, client, NULL, NULL, 10, cancellable,
+                          (GAsyncReadyCallback)call_ready, value);
+}
+
+static void
+iterate (void)
+{
+    while (g_main_context_iteration (NULL, FALSE))
+        ;
+}
+
+static void
+test_coalesce_join_invalidate (void)
+{
+    GObject *client;
+    gint a, b, c, d;
+
+    client = g_object_new (G_TYPE_OBJECT, NULL);
+    n_transactions = 0;
+
+    /* Identical reads share a transaction */
+    call (client, NULL, &a);
+    call (client, NULL, &b);
+    g_assert_cmpuint (n_transactions, ==, 1);
+
+    /* Once invalidated, later callers don't join the older transaction */
+    qmicli_coalesce_invalidate ("fake/");
+    call (client, NULL, &c);
+    g_assert_cmpuint (n_transactions, ==, 2);
+
+    fake_complete (1);
+    g_assert_cmpint (a, ==, 1);
+    g_assert_cmpint (b, ==, 1);
+    g_assert_cmpint (c, ==, -1);
+
+    /* The response to the invalidated transaction isn't cached */
+    call (client, NULL, &d);
+    g_assert_cmpuint (n_transactions, ==, 2);
+    fake_complete (2);
+    g_assert_cmpint (c, ==, 2);
+    g_assert_cmpint (d, ==, 2);
+
+    /* This one is */
+    call (client, NULL, &a);
+    iterate ();
+    g_assert_cmpuint (n_transactions, ==, 2);
+    g_assert_cmpint (a, ==, 2);
+
+    qmicli_coalesce_shutdown ();
+    g_object_unref (client);
+}
+
+static void
+test_coalesce_cancel (void)
+{
+    GObject *client;
+    GCancellable *first;
+    GCancellable *second;
+    GCancellable *transaction;
+    gint a, b;
+
+    client = g_object_new (G_TYPE_OBJECT, NULL);
+    first = g_cancellable_new ();
+    second = g_cancellable_new ();
+    n_transactions = 0;
+
+    call (client, first, &a);
+    call (client, second, &b);
+    g_assert_cmpuint (n_transactions, ==, 1);
+    transaction = pending_cancellables->data;
+
+    /* A cancelled waiter completes right away; the others keep waiting */
+    g_cancellable_cancel (first);
+    iterate ();
+    g_assert_cmpint (a, ==, 0);
+    g_assert_cmpint (b, ==, -1);
+    g_assert (!g_cancellable_is_cancelled (transaction));
+
+    /* With no one left, the transaction is cancelled too */
+    g_cancellable_cancel (second);
+    iterate ();
+    g_assert_cmpint (b, ==, 0);
+    g_assert (g_cancellable_is_cancelled (transaction));
+
+    /* And no longer joined */
+    call (client, NULL, &a);
+    g_assert_cmpuint (n_transactions, ==, 2);
+
+    fake_complete (1);
+    fake_complete (3);
+    g_assert_cmpint (a, ==, 3);
+
+    qmicli_coalesce_shutdown ();
+    g_object_unref (first);
+    g_object_unref (second);
+    g_object_unref (client);
+}
+
+int main (int argc, char **argv)
+{
+    g_type_init ();
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/qmicli/coalesce/join-invalidate", test_coalesce_join_invalidate);
+    g_test_add_func ("/qmicli/coalesce/cancel", test_coalesce_cancel);
+
+    return g_test_run ();
+}
@@ -13,7 +13,17 @@
  * Copyright (C) 2012 Aleksander Morgado <aleksander@gnu.org>
  */
 
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <glib.h>
+#include <glib/gstdio.h>
+
+#include <libqmi-glib.h>
+#include <jansson.h>
+
+#include "qmicli.h"
 #include "qmicli-helpers.h"
 
 static void
@@ -112,8 +122,517 @@ test_helpers_raw_printable_4 (void)
     g_array_unref (array);
 }
 
+static void
+test_helpers_fields_parse (void)
+{
+    QmicliFields *fields = NULL;
+
+    g_assert (qmicli_read_fields_from_string (" .lte_service.status , signal_strength", &fields));
+    g_assert (fields != NULL);
+    qmicli_fields_free (fields);
+
+    fields = NULL;
+    g_assert (!qmicli_read_fields_from_string ("", &fields));
+    g_assert (!qmicli_read_fields_from_string ("lte_service.", &fields));
+    g_assert (!qmicli_read_fields_from_string ("lte_service..status", &fields));
+    g_assert (!qmicli_read_fields_from_string ("signal_strength,,", &fields));
+    g_assert (fields == NULL);
+}
+
+static void
+test_helpers_fields_match (void)
+{
+    QmicliFields *fields = NULL;
+    static const gchar *const lte[] = { "lte service.status", "lte service.cell id", NULL };
+    static const gchar *const gsm[] = { "gsm service.status", "gsm service.cell id", NULL };
+
+    g_assert (qmicli_read_fields_from_string ("LTE_service.status,signal strength", &fields));
+
+    /* Selected keys, the objects leading to them and the subtrees below them */
+    g_assert (qmicli_fields_match (fields, "lte service.status"));
+    g_assert (qmicli_fields_match (fields, "lte service"));
+    g_assert (qmicli_fields_match (fields, "signal strength.network"));
+
+    g_assert (!qmicli_fields_match (fields, "lte service.cell id"));
+    g_assert (!qmicli_fields_match (fields, "lte service.status details"));
+    g_assert (!qmicli_fields_match (fields, "lte"));
+    g_assert (!qmicli_fields_match (fields, "signal strength network"));
+
+    g_assert (qmicli_fields_match_any (fields, lte));
+    g_assert (!qmicli_fields_match_any (fields, gsm));
+
+    qmicli_fields_free (fields);
+
+    /* No projection */
+    g_assert (qmicli_fields_match (NULL, "lte service.cell id"));
+    g_assert (qmicli_fields_match_any (NULL, gsm));
+}
+
+static void
+test_helpers_packet_statistics_mask (void)
+{
+    QmiWdsPacketStatisticsMaskFlag mask;
+
+    g_assert (qmicli_read_packet_statistics_mask_from_string ("bytes, drops", &mask));
+    g_assert_cmpuint (mask, ==, (QMI_WDS_PACKET_STATISTICS_MASK_FLAG_TX_BYTES_OK |
+                                 QMI_WDS_PACKET_STATISTICS_MASK_FLAG_RX_BYTES_OK |
+                                 QMI_WDS_PACKET_STATISTICS_MASK_FLAG_TX_PACKETS_DROPPED |
+                                 QMI_WDS_PACKET_STATISTICS_MASK_FLAG_RX_PACKETS_DROPPED));
+
+    g_assert (qmicli_read_packet_statistics_mask_from_string (NULL, &mask));
+    g_assert (mask & QMI_WDS_PACKET_STATISTICS_MASK_FLAG_TX_OVERFLOWS);
+    g_assert (mask & QMI_WDS_PACKET_STATISTICS_MASK_FLAG_RX_PACKETS_OK);
+
+    g_assert (!qmicli_read_packet_statistics_mask_from_string ("bytes,octets", &mask));
+}
+
+static void
+test_helpers_network_scan_type (void)
+{
+    QmiNasNetworkScanType type;
+
+    type = 0;
+    g_assert (qmicli_read_network_scan_type_from_string ("lte", &type));
+    g_assert_cmpuint (type, ==, QMI_NAS_NETWORK_SCAN_TYPE_LTE);
+
+    type = 0;
+    g_assert (qmicli_read_network_scan_type_from_string ("gsm|umts|td-scdma", &type));
+    g_assert_cmpuint (type, ==, (QMI_NAS_NETWORK_SCAN_TYPE_GSM |
+                                 QMI_NAS_NETWORK_SCAN_TYPE_UMTS |
+                                 QMI_NAS_NETWORK_SCAN_TYPE_TD_SCDMA));
+
+    /* Case and blanks around the RATs don't matter, empty items are skipped */
+    type = 0;
+    g_assert (qmicli_read_network_scan_type_from_string (" LTE | Umts ||", &type));
+    g_assert_cmpuint (type, ==, (QMI_NAS_NETWORK_SCAN_TYPE_LTE |
+                                 QMI_NAS_NETWORK_SCAN_TYPE_UMTS));
+
+    /* But some RAT must be given, and all must be known */
+    type = 0;
+    g_assert (!qmicli_read_network_scan_type_from_string ("", &type));
+    g_assert (!qmicli_read_network_scan_type_from_string (" | ", &type));
+    g_assert (!qmicli_read_network_scan_type_from_string ("lte|5g", &type));
+    g_assert (!qmicli_read_network_scan_type_from_string ("lte umts", &type));
+}
+
+static void
+test_helpers_cid_registry (void)
+{
+    gchar *dir;
+    gchar *path;
+    guint8 cid;
+
+    dir = g_dir_make_tmp ("qmicli-test-XXXXXX", NULL);
+    g_assert (dir);
+    path = g_build_filename (dir, "registry", "dev_cdc-wdm0.cids", NULL);
+
+    /* Nothing registered yet */
+    g_assert (qmicli_cid_registry_take (path, "wds", &cid, NULL));
+    g_assert_cmpuint (cid, ==, 0);
+
+    g_assert (qmicli_cid_registry_put (path, "wds", 12, NULL));
+    g_assert (qmicli_cid_registry_put (path, "wds", 13, NULL));
+    g_assert (qmicli_cid_registry_put (path, "wds", 12, NULL));
+    g_assert (qmicli_cid_registry_put (path, "nas", 4, NULL));
+
+    /* CIDs are handed out once, and per service */
+    g_assert (qmicli_cid_registry_take (path, "wds", &cid, NULL));
+    g_assert_cmpuint (cid, ==, 12);
+    g_assert (qmicli_cid_registry_take (path, "wds", &cid, NULL));
+    g_assert_cmpuint (cid, ==, 13);
+    g_assert (qmicli_cid_registry_take (path, "wds", &cid, NULL));
+    g_assert_cmpuint (cid, ==, 0);
+    g_assert (qmicli_cid_registry_take (path, "nas", &cid, NULL));
+    g_assert_cmpuint (cid, ==, 4);
+
+    g_unlink (path);
+    g_free (path);
+    path = g_build_filename (dir, "registry", NULL);
+    g_rmdir (path);
+    g_rmdir (dir);
+    g_free (path);
+    g_free (dir);
+}
+
+static void
+test_helpers_subcommand (void)
+{
+    static const gchar *const services[] = { "dms", "wds", NULL };
+    static gchar *device_str;
+    static gint timeout_secs;
+    static gboolean verbose_flag;
+    static const GOptionEntry globals[] = {
+        { "device", 'd', 0, G_OPTION_ARG_STRING, &device_str, NULL, NULL },
+        { "timeout", 0, 0, G_OPTION_ARG_INT, &timeout_secs, NULL, NULL },
+        { "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose_flag, NULL, NULL },
+        { NULL }
+    };
+    gchar *legacy[] = { "qmicli", "-d", "/dev/cdc-wdm0", "--wds-noop", NULL };
+    gchar *with_value[] = { "qmicli", "wds", "start-network", "internet", "-d", "/dev/cdc-wdm0", NULL };
+    gchar *without_value[] = { "qmicli", "dms", "get-ids", "-d", "/dev/cdc-wdm0", NULL };
+    gchar *globals_first[] = { "qmicli", "-vd", "/dev/cdc-wdm0", "--timeout=5", "dms", "get-ids", NULL };
+    gchar *unknown_first[] = { "qmicli", "--wds-noop", "dms", "get-ids", NULL };
+    gchar *dash_value[] = { "qmicli", "-d", "/dev/cdc-wdm0", "wds", "set-foo", "-3", NULL };
+    gchar *equal_value[] = { "qmicli", "wds", "set-foo=--bar", "-v", NULL };
+    gchar **argv;
+    gchar *service = NULL;
+    gint argc;
+
+    argc = 4;
+    argv = legacy;
+    g_assert (!qmicli_expand_subcommand (services, globals, &argc, &argv, &service));
+    g_assert (argv == legacy);
+    g_assert_cmpint (argc, ==, 4);
+
+    argc = 6;
+    argv = with_value;
+    g_assert (qmicli_expand_subcommand (services, globals, &argc, &argv, &service));
+    g_assert_cmpstr (service, ==, "wds");
+    g_assert_cmpint (argc, ==, 4);
+    g_assert_cmpstr (argv[1], ==, "--wds-start-network=internet");
+    g_assert_cmpstr (argv[2], ==, "-d");
+    g_assert (argv[4] == NULL);
+    g_strfreev (argv);
+    g_free (service);
+
+    argc = 5;
+    argv = without_value;
+    g_assert (qmicli_expand_subcommand (services, globals, &argc, &argv, &service));
+    g_assert_cmpstr (service, ==, "dms");
+    g_assert_cmpint (argc, ==, 4);
+    g_assert_cmpstr (argv[1], ==, "--dms-get-ids");
+    g_strfreev (argv);
+    g_free (service);
+
+    /* Global options, with their values, may come before the service */
+    argc = 6;
+    argv = globals_first;
+    g_assert (qmicli_expand_subcommand (services, globals, &argc, &argv, &service));
+    g_assert_cmpstr (service, ==, "dms");
+    g_assert_cmpint (argc, ==, 5);
+    g_assert_cmpstr (argv[1], ==, "-vd");
+    g_assert_cmpstr (argv[2], ==, "/dev/cdc-wdm0");
+    g_assert_cmpstr (argv[3], ==, "--timeout=5");
+    g_assert_cmpstr (argv[4], ==, "--dms-get-ids");
+    g_strfreev (argv);
+    g_free (service);
+
+    /* Other options may not */
+    argc = 4;
+    argv = unknown_first;
+    g_assert (!qmicli_expand_subcommand (services, globals, &argc, &argv, &service));
+    g_assert (argv == unknown_first);
+
+    /* Values starting with '-' */
+    argc = 6;
+    argv = dash_value;
+    g_assert (qmicli_expand_subcommand (services, globals, &argc, &argv, &service));
+    g_assert_cmpint (argc, ==, 4);
+    g_assert_cmpstr (argv[3], ==, "--wds-set-foo=-3");
+    g_strfreev (argv);
+    g_free (service);
+
+    argc = 4;
+    argv = equal_value;
+    g_assert (qmicli_expand_subcommand (services, globals, &argc, &argv, &service));
+    g_assert_cmpint (argc, ==, 3);
+    g_assert_cmpstr (argv[1], ==, "--wds-set-foo=--bar");
+    g_assert_cmpstr (argv[2], ==, "-v");
+    g_strfreev (argv);
+    g_free (service);
+}
+
+static void
+test_helpers_version_info_cache (void)
+{
+    QmiDeviceServiceVersionInfo info[] = {
+        { QMI_SERVICE_DMS, 1, 3 },
+        { QMI_SERVICE_WDS, 1, 12 },
+    };
+    QmiDeviceServiceVersionInfo *loaded;
+    GArray *services;
+    gchar *dir;
+    gchar *path;
+
+    dir = g_dir_make_tmp ("qmicli-test-XXXXXX", NULL);
+    g_assert (dir);
+    path = g_build_filename (dir, "dev_cdc-wdm0.services", NULL);
+
+    g_assert (qmicli_version_info_cache_load (path) == NULL);
+
+    services = g_array_new (FALSE, FALSE, sizeof (QmiDeviceServiceVersionInfo));
+    g_array_append_vals (services, info, G_N_ELEMENTS (info));
+    g_assert (qmicli_version_info_cache_save (path, services, NULL));
+    g_array_unref (services);
+
+    services = qmicli_version_info_cache_load (path);
+    g_assert (services);
+    g_assert_cmpuint (services->len, ==, 2);
+    loaded = &g_array_index (services, QmiDeviceServiceVersionInfo, 1);
+    g_assert_cmpuint (loaded->service, ==, QMI_SERVICE_WDS);
+    g_assert_cmpuint (loaded->major_version, ==, 1);
+    g_assert_cmpuint (loaded->minor_version, ==, 12);
+    g_array_unref (services);
+
+    g_unlink (path);
+    g_rmdir (dir);
+    g_free (path);
+    g_free (dir);
+}
+
+static void
+test_helpers_history (void)
+{
+    QmicliHistory *history;
+    QmicliHistoryAggregate aggregate;
+    gint16 values[2];
+    guint first;
+    guint i;
+
+    history = qmicli_history_new (4, 2);
+    g_assert_cmpuint (qmicli_history_get_length (history), ==, 0);
+    g_assert_cmpuint (qmicli_history_last (history, 10, &first), ==, 0);
+
+    /* Six samples into four slots; the two oldest are gone */
+    for (i = 1; i <= 6; i++) {
+        values[0] = -100 + i;
+        values[1] = (i % 2) ? QMICLI_HISTORY_MISSING : i;
+        qmicli_history_append (history, i * 10, values);
+    }
+    g_assert_cmpuint (qmicli_history_get_length (history), ==, 4);
+    g_assert_cmpint (qmicli_history_get_timestamp (history, 0), ==, 30);
+    g_assert_cmpint (qmicli_history_get_timestamp (history, 3), ==, 60);
+    g_assert_cmpint (qmicli_history_get_value (history, 0, 0), ==, -97);
+
+    g_assert_cmpuint (qmicli_history_last (history, 2, &first), ==, 2);
+    g_assert_cmpuint (first, ==, 2);
+    qmicli_history_aggregate (history, first, 2, 0, &aggregate);
+    g_assert_cmpuint (aggregate.count, ==, 2);
+    g_assert_cmpint (aggregate.min, ==, -95);
+    g_assert_cmpint (aggregate.max, ==, -94);
+
+    g_assert_cmpuint (qmicli_history_range (history, 35, 50, &first), ==, 2);
+    g_assert_cmpuint (first, ==, 1);
+    g_assert_cmpuint (qmicli_history_range (history, 0, 20, &first), ==, 0);
+
+    /* Missing values don't count */
+    qmicli_history_aggregate (history, 0, 4, 1, &aggregate);
+    g_assert_cmpuint (aggregate.count, ==, 2);
+    g_assert_cmpint (aggregate.min, ==, 4);
+    g_assert_cmpint (aggregate.max, ==, 6);
+    g_assert_cmpfloat (aggregate.avg, ==, 5.0);
+
+    qmicli_history_free (history);
+}
+
+typedef struct {
+    guint count;
+    gint64 first;
+    gint64 last;
+    gint16 last_value;
+    gboolean columns_ok;
+} SampleLogCounter;
+
+static void
+sample_log_count (const gchar *const *columns,
+                  gint64 timestamp,
+                  const gint16 *values,
+                  SampleLogCounter *counter)
+{
+    if (!counter->count)
+        counter->first = timestamp;
+    counter->last = timestamp;
+    counter->last_value = values[1];
+    counter->columns_ok = (g_strv_length ((gchar **)columns) == 2 &&
+                           g_str_equal (columns[0], "rssi") &&
+                           g_str_equal (columns[1], "snr"));
+    counter->count++;
+}
+
+static void
+test_helpers_sample_log (void)
+{
+    static const gchar *const columns[] = { "rssi", "snr", NULL };
+    /* One segment is 64 blocks of 256 records */
+    const guint per_segment = 64 * 256;
+    SampleLogCounter counter;
+    QmicliSampleLog *log;
+    GDir *gdir;
+    gchar *dir;
+    gchar *path;
+    gint16 values[2];
+    guint corrupt;
+    guint n_files;
+    guint i;
+    gint fd;
+
+    dir = g_dir_make_tmp ("qmicli-test-XXXXXX", NULL);
+    g_assert (dir);
+
+    /* Three segments' worth into at most two */
+    log = qmicli_sample_log_open (dir, columns, 2, NULL);
+    g_assert (log);
+    for (i = 0; i < 3 * per_segment; i++) {
+        values[0] = -80;
+        values[1] = i % 300;
+        g_assert (qmicli_sample_log_append (log, i, values, NULL));
+    }
+    qmicli_sample_log_close (log);
+
+    n_files = 0;
+    gdir = g_dir_open (dir, 0, NULL);
+    while (g_dir_read_name (gdir))
+        n_files++;
+    g_dir_close (gdir);
+    g_assert_cmpuint (n_files, ==, 2);
+
+    memset (&counter, 0, sizeof (counter));
+    g_assert (qmicli_sample_log_read (dir, G_MININT64, G_MAXINT64,
+                                      (QmicliSampleLogFunc)sample_log_count, &counter,
+                                      &corrupt, NULL));
+    g_assert_cmpuint (corrupt, ==, 0);
+    g_assert_cmpuint (counter.count, ==, 2 * per_segment);
+    g_assert_cmpint (counter.first, ==, per_segment);
+    g_assert_cmpint (counter.last, ==, 3 * per_segment - 1);
+    g_assert_cmpint (counter.last_value, ==, (3 * per_segment - 1) % 300);
+    g_assert (counter.columns_ok);
+
+    /* Range queries */
+    memset (&counter, 0, sizeof (counter));
+    g_assert (qmicli_sample_log_read (dir, 20000, 20999,
+                                      (QmicliSampleLogFunc)sample_log_count, &counter,
+                                      NULL, NULL));
+    g_assert_cmpuint (counter.count, ==, 1000);
+    g_assert_cmpint (counter.first, ==, 20000);
+
+    /* A flipped byte in the first record of the newest segment only loses
+     * that block */
+    path = g_build_filename (dir, "samples-00000002.qsl", NULL);
+    fd = g_open (path, O_RDWR, 0);
+    g_assert (fd >= 0);
+    g_assert (lseek (fd, 4096 + 24 + 8, SEEK_SET) == 4096 + 24 + 8);
+    g_assert (write (fd, "\xff", 1) == 1);
+    close (fd);
+
+    memset (&counter, 0, sizeof (counter));
+    g_assert (qmicli_sample_log_read (dir, G_MININT64, G_MAXINT64,
+                                      (QmicliSampleLogFunc)sample_log_count, &counter,
+                                      &corrupt, NULL));
+    g_assert_cmpuint (corrupt, ==, 1);
+    g_assert_cmpuint (counter.count, ==, 2 * per_segment - 256);
+
+    g_unlink (path);
+    g_free (path);
+    path = g_build_filename (dir, "samples-00000001.qsl", NULL);
+    g_unlink (path);
+    g_free (path);
+    g_rmdir (dir);
+    g_free (dir);
+}
+
+static guint
+count_files (const gchar *dir)
+{
+    GDir *gdir;
+    guint n_files = 0;
+
+    gdir = g_dir_open (dir, 0, NULL);
+    while (g_dir_read_name (gdir))
+        n_files++;
+    g_dir_close (gdir);
+    return n_files;
+}
+
+static void
+test_helpers_sample_log_reopen (void)
+{
+    static const gchar *const columns[] = { "rssi", "snr", NULL };
+    static const gchar *const other_columns[] = { "rssi", "rsrp", NULL };
+    const guint per_segment = 64 * 256;
+    SampleLogCounter counter;
+    QmicliSampleLog *log;
+    const gchar *name;
+    GDir *gdir;
+    gchar *dir;
+    gchar *path;
+    gint16 values[2] = { -80, 0 };
+    guint corrupt;
+    guint i;
+
+    dir = g_dir_make_tmp ("qmicli-test-XXXXXX", NULL);
+    g_assert (dir);
+
+    /* Restarting a writer carries on in the same segment, partial block
+     * included */
+    log = qmicli_sample_log_open (dir, columns, 4, NULL);
+    g_assert (log);
+    for (i = 0; i < 1000; i++)
+        g_assert (qmicli_sample_log_append (log, i, values, NULL));
+    qmicli_sample_log_close (log);
+
+    log = qmicli_sample_log_open (dir, columns, 4, NULL);
+    g_assert (log);
+    for (; i < 2000; i++)
+        g_assert (qmicli_sample_log_append (log, i, values, NULL));
+    qmicli_sample_log_close (log);
+    g_assert_cmpuint (count_files (dir), ==, 1);
+
+    memset (&counter, 0, sizeof (counter));
+    g_assert (qmicli_sample_log_read (dir, G_MININT64, G_MAXINT64,
+                                      (QmicliSampleLogFunc)sample_log_count, &counter,
+                                      &corrupt, NULL));
+    g_assert_cmpuint (corrupt, ==, 0);
+    g_assert_cmpuint (counter.count, ==, 2000);
+    g_assert_cmpint (counter.first, ==, 0);
+    g_assert_cmpint (counter.last, ==, 1999);
+
+    /* Other columns get a segment of their own, the older one is kept */
+    log = qmicli_sample_log_open (dir, other_columns, 4, NULL);
+    g_assert (log);
+    for (; i < 2100; i++)
+        g_assert (qmicli_sample_log_append (log, i, values, NULL));
+    qmicli_sample_log_close (log);
+    g_assert_cmpuint (count_files (dir), ==, 2);
+
+    /* And a full segment isn't reopened either */
+    log = qmicli_sample_log_open (dir, columns, 4, NULL);
+    g_assert (log);
+    for (; i < 2100 + per_segment; i++)
+        g_assert (qmicli_sample_log_append (log, i, values, NULL));
+    qmicli_sample_log_close (log);
+    g_assert_cmpuint (count_files (dir), ==, 3);
+
+    log = qmicli_sample_log_open (dir, columns, 4, NULL);
+    g_assert (log);
+    for (; i < 2200 + per_segment; i++)
+        g_assert (qmicli_sample_log_append (log, i, values, NULL));
+    qmicli_sample_log_close (log);
+    g_assert_cmpuint (count_files (dir), ==, 4);
+
+    /* No sample got lost on the way */
+    memset (&counter, 0, sizeof (counter));
+    g_assert (qmicli_sample_log_read (dir, G_MININT64, G_MAXINT64,
+                                      (QmicliSampleLogFunc)sample_log_count, &counter,
+                                      &corrupt, NULL));
+    g_assert_cmpuint (corrupt, ==, 0);
+    g_assert_cmpuint (counter.count, ==, 2200 + per_segment);
+    g_assert_cmpint (counter.first, ==, 0);
+    g_assert_cmpint (counter.last, ==, 2199 + per_segment);
+
+    gdir = g_dir_open (dir, 0, NULL);
+    while ((name = g_dir_read_name (gdir))) {
+        path = g_build_filename (dir, name, NULL);
+        g_unlink (path);
+        g_free (path);
+    }
+    g_dir_close (gdir);
+    g_rmdir (dir);
+    g_free (dir);
+}
+
 int main (int argc, char **argv)
 {
+    g_type_init ();
     g_test_init (&argc, &argv, NULL);
 
     g_test_add_func ("/qmicli/helpers/raw-printable/1",  test_helpers_raw_printable_1);
@@ -121,5 +640,16 @@ int main (int argc, char **argv)
     g_test_add_func ("/qmicli/helpers/raw-printable/3",  test_helpers_raw_printable_3);
     g_test_add_func ("/qmicli/helpers/raw-printable/4",  test_helpers_raw_printable_4);
 
+    g_test_add_func ("/qmicli/helpers/fields/parse", test_helpers_fields_parse);
+    g_test_add_func ("/qmicli/helpers/fields/match", test_helpers_fields_match);
+    g_test_add_func ("/qmicli/helpers/packet-statistics-mask", test_helpers_packet_statistics_mask);
+    g_test_add_func ("/qmicli/helpers/network-scan-type", test_helpers_network_scan_type);
+    g_test_add_func ("/qmicli/helpers/cid-registry", test_helpers_cid_registry);
+    g_test_add_func ("/qmicli/helpers/subcommand", test_helpers_subcommand);
+    g_test_add_func ("/qmicli/helpers/version-info-cache", test_helpers_version_info_cache);
+    g_test_add_func ("/qmicli/helpers/history", test_helpers_history);
+    g_test_add_func ("/qmicli/helpers/sample-log", test_helpers_sample_log);
+    g_test_add_func ("/qmicli/helpers/sample-log/reopen", test_helpers_sample_log_reopen);
+
     return g_test_run ();
 }
@@ -0,0 +1,146 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <libqmi-glib.h>
+#include <jansson.h>
+
+#include "qmicli.h"
+
+/* Jobs just note that they run, and stay in flight until the test says
+ * they're done */
+
+typedef struct {
+    const gchar *name;
+    QmicliJob *job;
+} TestJob;
+
+static GString *order;
+
+static void
+job_run (QmicliJob *job,
+         TestJob *test_job)
+{
+    test_job->job = job;
+    g_string_append_printf (order, "%s%s", order->len ? " " : "", test_job->name);
+}
+
+static void
+submit (QmiService service,
+        QmicliPriority priority,
+        const gchar *owner,
+        TestJob *test_job)
+{
+    test_job->job = NULL;
+    qmicli_scheduler_submit (service, priority, owner, (QmicliJobFunc)job_run, test_job);
+}
+
+static void
+done (TestJob *test_job)
+{
+    g_assert (test_job->job);
+    qmicli_scheduler_done (test_job->job);
+    test_job->job = NULL;
+}
+
+static void
+test_scheduler_order (void)
+{
+    TestJob scan = { "scan" }, scan2 = { "scan2" };
+    TestJob p1 = { "p1" }, p2 = { "p2" };
+    TestJob a1 = { "a1" }, a2 = { "a2" }, b1 = { "b1" };
+
+    order = g_string_new (NULL);
+    qmicli_scheduler_set_limit (QMI_SERVICE_NAS, 2);
+
+    /* A bulk job gets a free slot, but never the last one */
+    submit (QMI_SERVICE_NAS, QMICLI_PRIORITY_BULK, "survey", &scan);
+    submit (QMI_SERVICE_NAS, QMICLI_PRIORITY_BULK, "survey", &scan2);
+    g_assert (scan.job);
+    g_assert (!scan2.job);
+
+    /* Which is left for the others */
+    submit (QMI_SERVICE_NAS, QMICLI_PRIORITY_PERIODIC, "monitor", &p1);
+    g_assert (p1.job);
+
+    /* Both slots taken now */
+    submit (QMI_SERVICE_NAS, QMICLI_PRIORITY_INTERACTIVE, "a", &a1);
+    submit (QMI_SERVICE_NAS, QMICLI_PRIORITY_INTERACTIVE, "a", &a2);
+    submit (QMI_SERVICE_NAS, QMICLI_PRIORITY_INTERACTIVE, "b", &b1);
+    submit (QMI_SERVICE_NAS, QMICLI_PRIORITY_PERIODIC, "monitor", &p2);
+    g_assert_cmpstr (order->str, ==, "scan p1");
+
+    /* Interactive first, owners taking turns; then periodic, and bulk
+     * only once nothing else is in flight */
+    done (&p1);
+    done (&a1);
+    done (&scan);
+    done (&b1);
+    g_assert_cmpstr (order->str, ==, "scan p1 a1 b1 a2 p2");
+    done (&a2);
+    g_assert (!scan2.job);
+    done (&p2);
+    g_assert_cmpstr (order->str, ==, "scan p1 a1 b1 a2 p2 scan2");
+    done (&scan2);
+
+    g_string_free (order, TRUE);
+}
+
+static void
+test_scheduler_limits (void)
+{
+    TestJob x = { "x" }, y = { "y" }, z = { "z" }, i1 = { "i1" };
+    TestJob d1 = { "d1" }, d2 = { "d2" };
+
+    order = g_string_new (NULL);
+
+    /* With room for three, two bulk jobs may run */
+    qmicli_scheduler_set_limit (QMI_SERVICE_WDS, 3);
+    submit (QMI_SERVICE_WDS, QMICLI_PRIORITY_BULK, "x", &x);
+    submit (QMI_SERVICE_WDS, QMICLI_PRIORITY_BULK, "y", &y);
+    submit (QMI_SERVICE_WDS, QMICLI_PRIORITY_BULK, "z", &z);
+    submit (QMI_SERVICE_WDS, QMICLI_PRIORITY_INTERACTIVE, "i", &i1);
+    g_assert_cmpstr (order->str, ==, "x y i1");
+
+    /* Limits are per service; with a single slot, bulk jobs may take it */
+    qmicli_scheduler_set_limit (QMI_SERVICE_DMS, 1);
+    submit (QMI_SERVICE_DMS, QMICLI_PRIORITY_BULK, "d", &d1);
+    submit (QMI_SERVICE_DMS, QMICLI_PRIORITY_INTERACTIVE, "d", &d2);
+    g_assert_cmpstr (order->str, ==, "x y i1 d1");
+    done (&d1);
+    g_assert_cmpstr (order->str, ==, "x y i1 d1 d2");
+    done (&d2);
+
+    /* The last WDS slot stays free for anything but bulk */
+    done (&i1);
+    g_assert (!z.job);
+    done (&x);
+    g_assert_cmpstr (order->str, ==, "x y i1 d1 d2 z");
+    done (&y);
+    done (&z);
+
+    g_string_free (order, TRUE);
+}
+
+int main (int argc, char **argv)
+{
+    g_type_init ();
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/qmicli/scheduler/order", test_scheduler_order);
+    g_test_add_func ("/qmicli/scheduler/limits", test_scheduler_limits);
+
+    return g_test_run ();
+}